@@ -4,22 +4,95 @@
 /*  Defines  */
 
 #define DELAY_LOOP  100
+#define SAVE_WAIT   30
+//#define BOOT_TIMER    // Type the time from setup() to the first frame in microseconds
+
+#ifdef __AVR_ATtiny85__
+#define BOOT_TIMER_PRESCALE 2048 // 512 us per count at 4 MHz, up to 130 ms
+#else
+#define BOOT_TIMER_PRESCALE 1024 // 64 us per count at 16 MHz
+#endif
+
+/*  Local Functions  */
+
+#ifdef BOOT_TIMER
+static void     startBootTimer(void);
+static void     typeBootTime(void);
+#endif
+
+/*  Local Variables  */
+
+static uint8_t  saveCounter;
 
 /*---------------------------------------------------------------------------*/
 
 void setup(void)
 {
+#ifdef BOOT_TIMER
+    startBootTimer();
+#endif
     initCore();
     initCalc();
+#ifdef __AVR_ATmega32U4__
+    initSerial();
+#endif
     refreshScreen(drawCalc);
+#ifdef BOOT_TIMER
+    typeBootTime();
+#endif
 }
 
 void loop(void)
 {
+#ifdef __AVR_ATtiny85__
+    bool isBatteryChanged = managePower();
+#else
+    bool isBatteryChanged = false;
+#endif
     uint8_t button = getDownButton();
-    if (button != BTN_NONE) {
-        bool isInvalid = updateCalc(button);
-        if (isInvalid) refreshScreen(drawCalc);
+    bool isInvalid = (button != BTN_NONE && updateCalc(button));
+#ifdef __AVR_ATmega32U4__
+    if (handleSerial()) isInvalid = true;
+#endif
+    if (isInvalid) {
+        saveCounter = SAVE_WAIT;
+    } else if (button == BTN_NONE && saveCounter > 0 && --saveCounter == 0) {
+        saveCalc();
+    }
+    if (isInvalid || isBatteryChanged) refreshScreen(drawCalc);
+#ifdef __AVR_ATtiny85__
+    if (isSlowClock()) {
+        _delay_ms(DELAY_LOOP / 2); // counted at the halved clock
+        return;
     }
+#endif
     _delay_ms(DELAY_LOOP);
 }
+
+/*---------------------------------------------------------------------------*/
+
+#ifdef BOOT_TIMER
+static void startBootTimer(void)
+{
+    TCNT1 = 0;
+#ifdef __AVR_ATtiny85__
+    TCCR1 = _BV(CS13) | _BV(CS12);
+#else
+    TCCR1A = 0; // the Arduino core sets it up for PWM
+    TCCR1B = _BV(CS12) | _BV(CS10);
+#endif
+}
+
+static void typeBootTime(void)
+{
+    /*  The number is typed as keys, so it is shown without any other output.  */
+    uint32_t us = (uint32_t)TCNT1 * BOOT_TIMER_PRESCALE / (F_CPU / 1000000UL);
+    uint8_t digits[10], len = 0;
+    do {
+        digits[len++] = us % 10;
+        us /= 10;
+    } while (us > 0);
+    while (len > 0) updateCalc(BTN_0 + digits[--len]);
+    refreshScreen(drawCalc);
+}
+#endif
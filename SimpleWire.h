@@ -27,6 +27,14 @@
       if (SIMPLEWIRE::write(SLAVE_ADDR, buf, len) != (int)len)
         // error
       ...
+      // write from program memory
+      if (SIMPLEWIRE::write_P(SLAVE_ADDR, buf_P, len) != (int)len)
+        // error
+      ...
+      // write segments in one transaction (total length up to 32767)
+      if (SIMPLEWIRE::write(SLAVE_ADDR, segment) != total)
+        // error
+      ...
       // read
       if (SIMPLEWIRE::read(SLAVE_ADDR, buf, len) != (int)len)
         // error
@@ -59,6 +67,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 #include <util/delay_basic.h>
 
 #ifndef SimpleWire_HS_MODE
@@ -318,6 +328,55 @@ class SimpleWire
       return cnt;
     }
 
+    static int write_P(uint8_t addr, const uint8_t *buf, uint8_t len)
+    {
+      int cnt = -1;
+      // start
+      start();
+      // write slave address
+      if (write((addr << 1) | SimpleWire_WRITE) == 0)
+      {
+        // write data from program memory
+        for (cnt = 0; cnt < len; ++cnt)
+        {
+          if (write(pgm_read_byte(buf++)))
+            break;
+        }
+      }
+      // stop
+      stop();
+      return cnt;
+    }
+
+    static int write(uint8_t addr, const uint8_t *(*segment)(uint8_t idx, uint8_t &len))
+    {
+      int cnt = -1;
+      // start
+      start();
+      // write slave address
+      if (write((addr << 1) | SimpleWire_WRITE) == 0)
+      {
+        // write data segments until the callback returns null
+        const uint8_t *buf;
+        uint8_t len, n;
+        cnt = 0;
+        for (uint8_t idx = 0; (buf = segment(idx, len)) != 0; ++idx)
+        {
+          for (n = 0; n < len; ++n)
+          {
+            if (write(buf[n]))
+              break;
+          }
+          cnt += n;
+          if (n < len)
+            break;
+        }
+      }
+      // stop
+      stop();
+      return cnt;
+    }
+
     static int read(uint8_t addr, uint8_t *buf, uint8_t len)
     {
       int cnt = -1;
@@ -1,30 +1,121 @@
+#include <avr/eeprom.h>
 #include "common.h"
 #include "data.h"
 
 /*  Defines  */
 
 #define RADIX       10
-#define LENGTH_MAX  8
-#define STACK_SIZE  16
-#define DECODE_MAX  12
+#ifdef __AVR_ATmega32U4__
+#define LENGTH_MAX  12  // 64-bit mantissa
+#define HALF_RADIX  1000000LL
+#define BIG_NUMBER  9999999999999ULL
+#define UNDO_SIZE   160
+#else
+#define LENGTH_MAX  8   // 32-bit mantissa
+#define HALF_RADIX  10000L
 #define BIG_NUMBER  999999999UL
+#define UNDO_SIZE   32
+#endif
+#define DISPLAY_MAX 8
+#define STACK_SIZE  16 // power of 2
+#define STACK_MASK  (STACK_SIZE - 1)
+#define GAUGE_W     (STACK_SIZE * 2)
+#ifdef BATTERY_LEVELS
+#define BATTERY_W   (BATTERY_LEVELS * 2 + 5) // gap, walls and terminal
+#else
+#define BATTERY_W   0
+#endif
+#define DECODE_MAX  TEXT_MAX
+#define CACHE_SIZE  (DECODE_MAX / 2)
+#define CACHE_LINES (STACK_SIZE / 2) // power of 2, a slot goes to the line of its lower bits
+#define CACHE_MASK  (CACHE_LINES - 1)
+#define CACHE_EMPTY 0xFF
+#define NUMBER_PAGES  (IMG_DIGIT_H / PAGE_HEIGHT)
+#define NUMBER_LEVELS ((HEIGHT / PAGE_HEIGHT - 1) / NUMBER_PAGES) // drawn in full size
 #define EXP_MAX     99
+#define STEP_BITS   5
+#define SQRT_LOOP_MAX 32
+#define STAT_COUNT_MAX 0xFFFF
+#define PROGRAM_MAX 24
+#define PROGRAM_SIZE ((PROGRAM_MAX * STEP_BITS + 7) / 8 + 1)
+#define JOURNAL_SLOTS ((E2END + 1) / sizeof(JOURNAL_T))
+#define ERROR_BUTTONS (1UL << BTN_CLEAR | 1UL << BTN_ALLCLEAR | 1UL << BTN_UNDO) // act even in error
 
 /*  Typedefs  */
 
+enum : uint8_t { // kind of undo record, numbers in the record and error flag are added
+    UNDO_PUSH = 0,
+    UNDO_OPERATE,
+    UNDO_DROP,
+    UNDO_CLEAR,
+    UNDO_SWAP,
+    UNDO_ROLL,
+    UNDO_SIGMA,
+};
+
+#if defined HOST_MANT_T
+typedef HOST_MANT_T MANT_T; // counted on a host by tools/wcet
+typedef HOST_UMANT_T UMANT_T;
+#elif defined __AVR_ATmega32U4__
+typedef int64_t     MANT_T;
+typedef uint64_t    UMANT_T;
+#else
+typedef int32_t     MANT_T;
+typedef uint32_t    UMANT_T;
+#endif
+
 typedef struct {
-    int32_t m;
+    MANT_T  m;
     int8_t  exp;
 } NUM_T;
 
+typedef struct {
+    uint8_t seq;
+    uint8_t sum;
+    uint8_t info;   // stack depth and flags
+    uint8_t programLen;
+    uint8_t program[PROGRAM_SIZE];
+    uint16_t statCount;
+    NUM_T   statSum, statM2;
+    NUM_T   stack[STACK_SIZE]; // from the bottom
+} JOURNAL_T;
+
+typedef bool (*HANDLER_T)(uint8_t button);
 
 /*  Local Functions  */
 
+static void     resetCalc(void);
+static void     restoreCalc(void);
+static uint8_t  getChecksum(uint8_t info);
+static uint8_t  addChecksum(uint8_t sum, const void *p, uint8_t len);
+static bool     recordProgram(void);
+static bool     runProgram(void);
+static void     storeStep(uint8_t button);
+static uint8_t  loadStep(uint8_t idx);
+static NUM_T    *getLevel(uint8_t level);
+static void     setTop(uint8_t pos);
+static void     pushStack(void);
+static void     popStack(void);
+static void     exchangeSlots(uint8_t pos1, uint8_t pos2);
+static void     recordUndo(uint8_t kind, NUM_T *n1, NUM_T *n2, NUM_T *n3);
+static bool     undoLast(uint8_t);
+static void     writeUndo(const void *p, uint8_t len);
+static void     readUndo(void *p, uint8_t len);
+static bool     handleButton(uint8_t button);
+static bool     allClear(uint8_t);
 static void     prepareNumber(void);
-static bool     modifyNumber(uint8_t button);
-static bool     enterNumber(void);
-static bool     clearNumber(void);
-static bool     operate(void (*opFunc)(NUM_T *a, NUM_T *b));
+static bool     modifyNumber(uint8_t button, bool isLifting);
+static bool     enterNumber(uint8_t);
+static void     finishNumber(void);
+static bool     clearNumber(uint8_t);
+static bool     swapNumber(uint8_t);
+static bool     rollNumber(uint8_t);
+static bool     recallLastX(uint8_t);
+static bool     recallNumber(NUM_T *n);
+static bool     addStatistics(uint8_t);
+static bool     recallStatistics(uint8_t button);
+static void     getMean(NUM_T *n);
+static bool     operate(uint8_t button);
 
 static void     add(NUM_T *a, NUM_T *b);
 static void     sub(NUM_T *a, NUM_T *b);
@@ -32,11 +123,17 @@ static void     multi(NUM_T *a, NUM_T *b);
 static void     div(NUM_T *a, NUM_T *b);
 
 static void     setZero(NUM_T *n);
+static void     setError(NUM_T *n);
 static int8_t   getLength(NUM_T *n);
 static void     align(NUM_T *a, NUM_T *b);
-static void     normalize(NUM_T *n);
+static void     fit(NUM_T *n);
+static void     checkRange(NUM_T *n);
+static void     squareRoot(NUM_T *n);
 
+static void     invalidateCache(NUM_T *n);
+static void     copyCache(NUM_T *pDst, NUM_T *pSrc);
 static int8_t   decodeNumber(NUM_T *n);
+static int8_t   decodeCachedNumber(NUM_T *n);
 static void     drawStack(uint8_t *pBuffer);
 static void     drawNumber(uint8_t *pBuffer, int16_t x, int8_t row);
 static void     drawEntering(uint8_t *pBuffer);
@@ -47,9 +144,59 @@ PROGMEM static void (*const opFuncTable[])(NUM_T *a, NUM_T *b) = {
     add, sub, multi, div
 };
 
-static NUM_T    stack[STACK_SIZE], *pStack;
+PROGMEM static constexpr HANDLER_T handlerTable[] = { // in the order of buttons, NULL modifies the number
+    NULL,
+    NULL,           NULL,           NULL,           NULL,           NULL,
+    NULL,           NULL,           NULL,           NULL,           NULL,
+    enterNumber,    NULL,           NULL,
+    operate,        operate,        operate,        operate,
+    clearNumber,    allClear,       swapNumber,     rollNumber,     undoLast,
+    recallLastX,    addStatistics,  recallStatistics, recallStatistics, recallStatistics,
+};
+
+/*  Each entry is checked against its button, so a button inserted into the
+    enum of common.h fails to build until the table follows it.  */
+
+#define CHECK_HANDLER(button, func) \
+    static_assert(handlerTable[button] == func, #button " is not handled by " #func)
+
+static_assert(sizeof(handlerTable) / sizeof(handlerTable[0]) == BTN_SUM + 1, "handlerTable ends at BTN_SUM");
+CHECK_HANDLER(BTN_NONE, NULL);
+CHECK_HANDLER(BTN_0, NULL);
+CHECK_HANDLER(BTN_9, NULL);
+CHECK_HANDLER(BTN_ENTER, enterNumber);
+CHECK_HANDLER(BTN_DOT, NULL);
+CHECK_HANDLER(BTN_INVERT, NULL);
+CHECK_HANDLER(BTN_PLUS, operate);
+CHECK_HANDLER(BTN_MINUS, operate);
+CHECK_HANDLER(BTN_MULTI, operate);
+CHECK_HANDLER(BTN_DIV, operate);
+CHECK_HANDLER(BTN_CLEAR, clearNumber);
+CHECK_HANDLER(BTN_ALLCLEAR, allClear);
+CHECK_HANDLER(BTN_SWAP, swapNumber);
+CHECK_HANDLER(BTN_ROLL, rollNumber);
+CHECK_HANDLER(BTN_UNDO, undoLast);
+CHECK_HANDLER(BTN_LASTX, recallLastX);
+CHECK_HANDLER(BTN_SIGMA, addStatistics);
+CHECK_HANDLER(BTN_MEAN, recallStatistics);
+CHECK_HANDLER(BTN_SDEV, recallStatistics);
+CHECK_HANDLER(BTN_SUM, recallStatistics);
+
+static NUM_T    stack[STACK_SIZE], *pStack; // pStack points the top slot
+static uint8_t  stackMap[STACK_SIZE], stackTop, stackDepth; // ring of slot indexes
 static uint8_t  decodeBuffer[DECODE_MAX];
-static bool     isEntering, isDotted, isError;
+static uint8_t  decodeCache[CACHE_LINES][CACHE_SIZE]; // packed 2 glyphs per byte
+static uint8_t  cacheSlot[CACHE_LINES]; // slot whose glyphs are in the line
+static bool     isEntering, isDotted, isError, isSummed;
+static NUM_T    lastX;
+static uint16_t statCount;
+static NUM_T    statSum, statM2; // sum of numbers and sum of squared deviations
+static uint8_t  undoBuffer[UNDO_SIZE], undoHead, undoUsed; // ring of undo records
+static uint8_t  program[PROGRAM_SIZE], programLen; // packed 5 bits per step
+static bool     isRecording;
+
+EEMEM static JOURNAL_T journal[JOURNAL_SLOTS];
+static uint8_t  journalPos, journalSeq;
 
 /*---------------------------------------------------------------------------*/
 /*                               Main Functions                              */
@@ -57,29 +204,48 @@ static bool     isEntering, isDotted, isError;
 
 void initCalc(void)
 {
-    pStack = &stack[0];
-    prepareNumber();
-    isError = false;
+    resetCalc();
+    restoreCalc();
 }
 
 bool updateCalc(uint8_t button)
 {
-    if (button == BTN_ALLCLEAR) {
-        initCalc();
-        return true;
-    } else if (button == BTN_CLEAR) {
-        return clearNumber();
-    } else if (!isError) {
-        if (button == BTN_ENTER) {
-            return enterNumber();
-        } else if (button >= BTN_PLUS && button <= BTN_DIV) {
-            void *opFunc = pgm_read_ptr(&opFuncTable[button - BTN_PLUS]);
-            return operate((void (*)(NUM_T *a, NUM_T *b))opFunc);
-        } else {
-            return modifyNumber(button);
-        }
+    if (button == BTN_RECORD) {
+        return recordProgram();
+    } else if (button == BTN_RUN) {
+        return runProgram();
     }
-    return false;
+    if (isRecording) storeStep(button);
+    return handleButton(button);
+}
+
+void saveCalc(void)
+{
+    uint8_t info = (stackDepth - 1) | isEntering << 4 | isDotted << 5 | isError << 6 | isSummed << 7;
+    if (++journalPos == JOURNAL_SLOTS) journalPos = 0;
+    JOURNAL_T *pJournal = &journal[journalPos];
+    for (uint8_t level = 0; level < stackDepth; level++) {
+        eeprom_update_block(getLevel(level), &pJournal->stack[stackDepth - 1 - level], sizeof(NUM_T));
+    }
+    eeprom_update_block(program, pJournal->program, PROGRAM_SIZE);
+    eeprom_update_byte(&pJournal->programLen, programLen);
+    eeprom_update_word(&pJournal->statCount, statCount);
+    eeprom_update_block(&statSum, &pJournal->statSum, sizeof(NUM_T));
+    eeprom_update_block(&statM2, &pJournal->statM2, sizeof(NUM_T));
+    eeprom_update_byte(&pJournal->info, info);
+    eeprom_update_byte(&pJournal->sum, getChecksum(info));
+    eeprom_update_byte(&pJournal->seq, ++journalSeq); // commit the record at last
+}
+
+int8_t decodeCalc(uint8_t level, char *pText)
+{
+    if (level >= stackDepth) return -1;
+    int8_t len = decodeCachedNumber(getLevel(level));
+    for (uint8_t *pBuf = &decodeBuffer[len]; pBuf > decodeBuffer; ) {
+        *pText++ = pgm_read_byte(&imgText[*--pBuf]);
+    }
+    *pText = '\0';
+    return len;
 }
 
 void drawCalc(int16_t y, uint8_t *pBuffer)
@@ -87,10 +253,251 @@ void drawCalc(int16_t y, uint8_t *pBuffer)
     clearScreenBuffer();
     if (y == 0) {
         drawStack(pBuffer);
-        decodeNumber(pStack);
     } else {
-        drawNumber(pBuffer, WIDTH + IMG_PADDING, (y - 8) >> 3);
-        if (y == 8 && isEntering) drawEntering(pBuffer);
+        /*  Full size numbers are stacked up from the bottom of the screen.  */
+        uint8_t page = (HEIGHT - PAGE_HEIGHT - y) / PAGE_HEIGHT;
+        uint8_t level = page / NUMBER_PAGES;
+        int8_t row = NUMBER_PAGES - 1 - page % NUMBER_PAGES;
+        if (level < NUMBER_LEVELS && level < stackDepth) {
+            decodeCachedNumber(getLevel(level));
+            drawNumber(pBuffer, WIDTH + IMG_PADDING, row);
+            if (level == 0 && row == 0 && isEntering) drawEntering(pBuffer);
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*                             Journal Functions                             */
+/*---------------------------------------------------------------------------*/
+
+static void resetCalc(void)
+{
+    for (uint8_t i = 0; i < STACK_SIZE; i++) {
+        stackMap[i] = i;
+    }
+    setTop(0);
+    stackDepth = 1;
+    memset(decodeCache, CACHE_EMPTY, sizeof(decodeCache));
+    prepareNumber();
+    isError = false;
+    setZero(&lastX);
+    undoUsed = 0;
+    statCount = 0;
+    setZero(&statSum);
+    setZero(&statM2);
+}
+
+static void restoreCalc(void)
+{
+    /*  The latest record is where the chain of sequence numbers breaks.  */
+    journalSeq = eeprom_read_byte(&journal[0].seq);
+    for (journalPos = 0; journalPos < JOURNAL_SLOTS - 1; journalPos++) {
+        uint8_t seq = eeprom_read_byte(&journal[journalPos + 1].seq);
+        if (seq != (uint8_t)(journalSeq + 1)) break;
+        journalSeq = seq;
+    }
+
+    JOURNAL_T *pJournal = &journal[journalPos];
+    uint8_t info = eeprom_read_byte(&pJournal->info);
+    eeprom_read_block(stack, pJournal->stack, ((info & 0x0F) + 1) * sizeof(NUM_T));
+    eeprom_read_block(program, pJournal->program, PROGRAM_SIZE);
+    programLen = eeprom_read_byte(&pJournal->programLen);
+    statCount = eeprom_read_word(&pJournal->statCount);
+    eeprom_read_block(&statSum, &pJournal->statSum, sizeof(NUM_T));
+    eeprom_read_block(&statM2, &pJournal->statM2, sizeof(NUM_T));
+    setTop(info & 0x0F); // the slots are in order from the bottom
+    if (eeprom_read_byte(&pJournal->sum) == getChecksum(info) && programLen <= PROGRAM_MAX) {
+        stackDepth = (info & 0x0F) + 1;
+        isEntering = info >> 4 & 1;
+        isDotted = info >> 5 & 1;
+        isError = info >> 6 & 1;
+        isSummed = info >> 7;
+    } else {
+        resetCalc(); // broken or empty journal
+        programLen = 0;
+    }
+}
+
+static uint8_t getChecksum(uint8_t info)
+{
+    uint8_t sum = addChecksum(info + programLen + statCount + (statCount >> 8), program, PROGRAM_SIZE);
+    sum = addChecksum(sum, &statSum, sizeof(NUM_T));
+    sum = addChecksum(sum, &statM2, sizeof(NUM_T));
+    for (uint8_t level = 0; level <= (info & 0x0F); level++) {
+        sum = addChecksum(sum, getLevel(level), sizeof(NUM_T));
+    }
+    return ~sum;
+}
+
+static uint8_t addChecksum(uint8_t sum, const void *p, uint8_t len)
+{
+    for (const uint8_t *pByte = (const uint8_t *)p; len > 0; len--) {
+        sum += *pByte++;
+    }
+    return sum;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                             Program Functions                             */
+/*---------------------------------------------------------------------------*/
+
+static bool recordProgram(void)
+{
+    isRecording = !isRecording;
+    if (isRecording) programLen = 0;
+    return true;
+}
+
+static bool runProgram(void)
+{
+    /*  Run all steps at once, the screen is refreshed only at the end.  */
+    bool ret = false;
+    if (!isRecording) {
+        for (uint8_t i = 0; i < programLen; i++) {
+            ret |= handleButton(loadStep(i));
+        }
+    }
+    return ret;
+}
+
+static void storeStep(uint8_t button)
+{
+    if (programLen < PROGRAM_MAX) {
+        uint16_t bitPos = programLen++ * STEP_BITS;
+        uint8_t *p = &program[bitPos >> 3];
+        uint16_t mask = ((1 << STEP_BITS) - 1) << (bitPos & 7);
+        uint16_t bits = ((p[0] | p[1] << 8) & ~mask) | button << (bitPos & 7);
+        p[0] = bits;
+        p[1] = bits >> 8;
+    }
+}
+
+static uint8_t loadStep(uint8_t idx)
+{
+    uint16_t bitPos = idx * STEP_BITS;
+    uint8_t *p = &program[bitPos >> 3];
+    return ((p[0] | p[1] << 8) >> (bitPos & 7)) & ((1 << STEP_BITS) - 1);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                              Stack Functions                              */
+/*---------------------------------------------------------------------------*/
+
+static NUM_T *getLevel(uint8_t level)
+{
+    return &stack[stackMap[(stackTop - level) & STACK_MASK]];
+}
+
+static void setTop(uint8_t pos)
+{
+    stackTop = pos & STACK_MASK;
+    pStack = &stack[stackMap[stackTop]];
+}
+
+static void pushStack(void)
+{
+    /*  Pushing onto the full ring reuses the slot of the oldest number.  */
+    setTop(stackTop + 1);
+    if (stackDepth < STACK_SIZE) stackDepth++;
+}
+
+static void popStack(void)
+{
+    setTop(stackTop - 1);
+    stackDepth--;
+}
+
+static void exchangeSlots(uint8_t pos1, uint8_t pos2)
+{
+    uint8_t *p1 = &stackMap[pos1 & STACK_MASK], *p2 = &stackMap[pos2 & STACK_MASK];
+    uint8_t slot = *p1;
+    *p1 = *p2;
+    *p2 = slot;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                               Undo Functions                              */
+/*---------------------------------------------------------------------------*/
+
+static void recordUndo(uint8_t kind, NUM_T *n1, NUM_T *n2, NUM_T *n3)
+{
+    /*  The kind byte is written last, so the latest record is read backward.  */
+    uint8_t count = 0;
+    if (n1) {
+        writeUndo(n1, sizeof(NUM_T));
+        count++;
+    }
+    if (n2) {
+        writeUndo(n2, sizeof(NUM_T));
+        count++;
+    }
+    if (n3) {
+        writeUndo(n3, sizeof(NUM_T));
+        count++;
+    }
+    kind |= count << 4 | isError << 7;
+    writeUndo(&kind, 1);
+    undoUsed += count * sizeof(NUM_T) + 1;
+    if (undoUsed > UNDO_SIZE) undoUsed = UNDO_SIZE; // the oldest records are overwritten
+}
+
+static bool undoLast(uint8_t)
+{
+    if (undoUsed == 0) return false;
+    uint8_t kind;
+    readUndo(&kind, 1);
+    uint8_t len = (kind >> 4 & 3) * sizeof(NUM_T) + 1;
+    if (len > undoUsed) { // partly overwritten
+        undoUsed = 0;
+        return false;
+    }
+    undoUsed -= len;
+
+    bool error = kind >> 7;
+    kind &= 0x0F;
+    if (kind == UNDO_PUSH) {
+        popStack();
+    } else if (kind == UNDO_OPERATE) {
+        NUM_T *n = pStack;
+        pushStack();
+        readUndo(pStack, sizeof(NUM_T));
+        readUndo(n, sizeof(NUM_T));
+        invalidateCache(n);
+    } else if (kind == UNDO_DROP || kind == UNDO_CLEAR) {
+        if (kind == UNDO_DROP) pushStack();
+        readUndo(pStack, sizeof(NUM_T));
+    } else if (kind == UNDO_SWAP) {
+        exchangeSlots(stackTop, stackTop - 1);
+        setTop(stackTop);
+    } else if (kind == UNDO_ROLL) {
+        setTop(stackTop + 1);
+        exchangeSlots(stackTop, stackTop - stackDepth);
+        setTop(stackTop);
+    } else if (kind == UNDO_SIGMA) {
+        readUndo(&statM2, sizeof(NUM_T));
+        readUndo(&statSum, sizeof(NUM_T));
+        readUndo(pStack, sizeof(NUM_T));
+        statCount--;
+    }
+    invalidateCache(pStack);
+    isEntering = false;
+    isError = error;
+    return true;
+}
+
+static void writeUndo(const void *p, uint8_t len)
+{
+    for (const uint8_t *pByte = (const uint8_t *)p; len > 0; len--) {
+        undoBuffer[undoHead] = *pByte++;
+        if (++undoHead == UNDO_SIZE) undoHead = 0;
+    }
+}
+
+static void readUndo(void *p, uint8_t len)
+{
+    for (uint8_t *pByte = (uint8_t *)p + len; len > 0; len--) {
+        if (undoHead-- == 0) undoHead = UNDO_SIZE - 1;
+        *--pByte = undoBuffer[undoHead];
     }
 }
 
@@ -98,28 +505,51 @@ void drawCalc(int16_t y, uint8_t *pBuffer)
 /*                             Control Functions                             */
 /*---------------------------------------------------------------------------*/
 
+static bool handleButton(uint8_t button)
+{
+    bool isLifting = !isSummed; // the count shown by sum is replaced by a new number
+    isSummed = false;
+    if (button == BTN_NONE || button >= sizeof(handlerTable) / sizeof(handlerTable[0])) return false;
+    if (isError && !(ERROR_BUTTONS >> button & 1)) return false;
+    HANDLER_T handler = (HANDLER_T)pgm_read_ptr(&handlerTable[button]);
+    return (handler) ? handler(button) : modifyNumber(button, isLifting);
+}
+
+static bool allClear(uint8_t)
+{
+    resetCalc();
+    return true;
+}
+
 static void prepareNumber(void)
 {
     setZero(pStack);
+    invalidateCache(pStack);
     isEntering = true;
     isDotted = false;
 }
 
-static bool modifyNumber(uint8_t button)
+static bool modifyNumber(uint8_t button, bool isLifting)
 {
     bool ret = false;
-    if (!isEntering && pStack < &stack[STACK_SIZE - 1]) {
-        pStack++;
+    if (!isEntering) {
+        if (isLifting) {
+            recordUndo(UNDO_PUSH, NULL, NULL, NULL);
+            pushStack();
+        } else {
+            recordUndo(UNDO_CLEAR, pStack, NULL, NULL);
+        }
         prepareNumber();
         ret = true;
     }
     if (isEntering) {
         if (button >= BTN_0 && button <= BTN_9) {
-            if (getLength(pStack) < LENGTH_MAX && 1 - pStack->exp < LENGTH_MAX) {
+            if (getLength(pStack) < DISPLAY_MAX && 1 - pStack->exp < DISPLAY_MAX) {
                 int8_t num = button - BTN_0;
                 if (pStack->m < 0) num = -num;
                 pStack->m = pStack->m * RADIX + num;
                 if (isDotted) pStack->exp--;
+                invalidateCache(pStack);
                 ret = true;
             }
         } else if (button == BTN_DOT) {
@@ -130,6 +560,7 @@ static bool modifyNumber(uint8_t button)
         } else if (button == BTN_INVERT) {
             if (pStack->m != 0) {
                 pStack->m = -pStack->m;
+                invalidateCache(pStack);
                 ret = true;
             }
         }
@@ -137,39 +568,163 @@ static bool modifyNumber(uint8_t button)
     return ret;
 }
 
-static bool enterNumber(void)
+static bool enterNumber(uint8_t)
 {
     if (isEntering) {
-        normalize(pStack);
-        isEntering = false;
-    } else if (pStack < &stack[STACK_SIZE - 1]) {
-        pStack++;
-        *pStack = *(pStack - 1);
+        finishNumber();
+    } else {
+        recordUndo(UNDO_PUSH, NULL, NULL, NULL);
+        pushStack();
+        NUM_T *n = getLevel(1);
+        *pStack = *n;
+        copyCache(pStack, n);
     }
     return true;
 }
 
-static bool clearNumber(void)
+static void finishNumber(void)
+{
+    fit(pStack);
+    invalidateCache(pStack);
+    isEntering = false;
+}
+
+static bool clearNumber(uint8_t)
 {
-    if (pStack > &stack[0]) {
-        pStack--;
+    if (isEntering) fit(pStack);
+    if (stackDepth > 1) {
+        recordUndo(UNDO_DROP, pStack, NULL, NULL);
+        popStack();
         isEntering = false;
     } else {
+        recordUndo(UNDO_CLEAR, pStack, NULL, NULL);
         prepareNumber();
     }
     isError = false;
     return true;
 }
 
-static bool operate(void (*opFunc)(NUM_T *a, NUM_T *b))
+static bool swapNumber(uint8_t)
 {
     bool ret = false;
-    if (pStack > &stack[0]) {
-        if (isEntering) normalize(pStack);
-        pStack--;
-        opFunc(pStack, pStack + 1);
-        normalize(pStack);
-        if (pStack->exp > 0) isError = true; // too large
+    if (stackDepth > 1) {
+        if (isEntering) finishNumber();
+        recordUndo(UNDO_SWAP, NULL, NULL, NULL);
+        exchangeSlots(stackTop, stackTop - 1);
+        setTop(stackTop);
+        ret = true;
+    }
+    return ret;
+}
+
+static bool rollNumber(uint8_t)
+{
+    /*  The top goes under the bottom, it is simply rotated if the ring is full.  */
+    bool ret = false;
+    if (stackDepth > 1) {
+        if (isEntering) finishNumber();
+        recordUndo(UNDO_ROLL, NULL, NULL, NULL);
+        exchangeSlots(stackTop, stackTop - stackDepth);
+        setTop(stackTop - 1);
+        ret = true;
+    }
+    return ret;
+}
+
+static bool recallLastX(uint8_t)
+{
+    return recallNumber(&lastX);
+}
+
+static bool recallNumber(NUM_T *n)
+{
+    if (isEntering) finishNumber();
+    recordUndo(UNDO_PUSH, NULL, NULL, NULL);
+    pushStack();
+    *pStack = *n;
+    invalidateCache(pStack);
+    checkRange(pStack);
+    return true;
+}
+
+static bool addStatistics(uint8_t)
+{
+    /*  Welford's update of M2, the number is replaced by the count.  */
+    if (isEntering) fit(pStack);
+    if (statCount == STAT_COUNT_MAX) { // the count would wrap around
+        recordUndo(UNDO_CLEAR, pStack, NULL, NULL);
+        setError(pStack);
+        invalidateCache(pStack);
+        isEntering = false;
+        return true;
+    }
+    recordUndo(UNDO_SIGMA, pStack, &statSum, &statM2);
+    NUM_T delta = *pStack, mean, t = *pStack;
+    getMean(&mean);
+    sub(&delta, &mean);
+    fit(&delta);
+    add(&statSum, &t);
+    fit(&statSum);
+    statCount++;
+    getMean(&mean);
+    t = *pStack;
+    sub(&t, &mean);
+    fit(&t);
+    multi(&delta, &t);
+    fit(&delta);
+    add(&statM2, &delta);
+    fit(&statM2);
+
+    setZero(pStack);
+    pStack->m = statCount;
+    invalidateCache(pStack);
+    isEntering = false;
+    isSummed = true;
+    return true;
+}
+
+static bool recallStatistics(uint8_t button)
+{
+    NUM_T n;
+    if (button == BTN_MEAN) {
+        getMean(&n);
+    } else if (button == BTN_SDEV) {
+        if (statCount < 2) return false;
+        NUM_T count = { statCount - 1, 0 };
+        n = statM2;
+        div(&n, &count);
+        fit(&n);
+        squareRoot(&n);
+    } else {
+        n = statSum;
+    }
+    return recallNumber(&n);
+}
+
+static void getMean(NUM_T *n)
+{
+    *n = statSum;
+    if (statCount > 0) {
+        NUM_T count = { statCount, 0 };
+        div(n, &count);
+        fit(n);
+    }
+}
+
+static bool operate(uint8_t button)
+{
+    bool ret = false;
+    if (stackDepth > 1) {
+        void *opFunc = pgm_read_ptr(&opFuncTable[button - BTN_PLUS]);
+        if (isEntering) fit(pStack);
+        NUM_T *n = pStack;
+        popStack();
+        recordUndo(UNDO_OPERATE, pStack, n, NULL);
+        lastX = *n;
+        ((void (*)(NUM_T *a, NUM_T *b))opFunc)(pStack, n);
+        fit(pStack);
+        checkRange(pStack);
+        invalidateCache(pStack);
         isEntering = false;
         ret = true;
     }
@@ -190,38 +745,36 @@ static void sub(NUM_T *a, NUM_T *b)
 
 static void multi(NUM_T *a, NUM_T *b)
 {
-    int32_t mA = abs(a->m), mB = abs(b->m);
-    if (mB != 0) {
-        while (BIG_NUMBER / mB < mA) {
-            a->exp++;
-            if (mA % RADIX == 0) {
-                mA /= RADIX;
-            } else if (mB % RADIX == 0 || mB > mA) {
-                mB /= RADIX;
-            } else {
-                mA /= RADIX;
-            }
-        }
+    /*  Multiply by halves and keep the upper digits of the exact product.  */
+    MANT_T mA = abs(a->m), mB = abs(b->m);
+    MANT_T hA = mA / HALF_RADIX, lA = mA % HALF_RADIX;
+    MANT_T hB = mB / HALF_RADIX, lB = mB % HALF_RADIX;
+    MANT_T low = lA * lB;
+    MANT_T mid = hA * lB + lA * hB + low / HALF_RADIX;
+    MANT_T high = hA * hB + mid / HALF_RADIX;
+    low = mid % HALF_RADIX * HALF_RADIX + low % HALF_RADIX;
+    while (high > 0) {
+        low = low / RADIX + high % RADIX * (HALF_RADIX * HALF_RADIX / RADIX);
+        high /= RADIX;
+        a->exp++;
     }
-    a->m = ((a->m < 0) == (b->m < 0)) ? mA * mB : -mA * mB;
+    a->m = ((a->m < 0) == (b->m < 0)) ? low : -low;
     a->exp += b->exp;
 }
 
 static void div(NUM_T *a, NUM_T *b)
 {
     if (b->m == 0) {
-        a->m = BIG_NUMBER;
-        a->exp = EXP_MAX;
-        isError = true;
+        setError(a);
         return;
     }
-    int32_t odd = a->m % b->m;
+    MANT_T odd = a->m % b->m;
     a->m /= b->m;
     a->exp -= b->exp;
     int8_t len = getLength(a);
     while (odd != 0 && len < LENGTH_MAX) {
         odd *= RADIX;
-        int32_t d = odd / b->m;
+        MANT_T d = odd / b->m;
         a->m = a->m * RADIX + d;
         len += (a->m != 0);
         a->exp--;
@@ -235,11 +788,18 @@ static void setZero(NUM_T *n)
     n->exp = 0;
 }
 
+static void setError(NUM_T *n)
+{
+    n->m = BIG_NUMBER; // too large to be shown
+    n->exp = EXP_MAX;
+    isError = true;
+}
+
 static int8_t getLength(NUM_T *n)
 {
     int8_t len = 0;
-    int32_t m = abs(n->m);
-    int32_t z = 1;
+    UMANT_T m = abs(n->m);
+    UMANT_T z = 1;
     while (m >= z) {
         len++;
         z *= RADIX;
@@ -253,27 +813,31 @@ static void align(NUM_T *a, NUM_T *b)
         align(b, a);
         return;
     }
+    if (a->m == 0) a->exp = b->exp; // zero has no digits to keep
     int8_t len = getLength(a);
     while (a->exp > b->exp) {
-        if (len < LENGTH_MAX) {
+        if (len <= LENGTH_MAX) { // keep a guard digit
             len++;
             a->exp--;
             a->m *= RADIX;
-        } else {
+        } else if (b->m != 0) {
             b->exp++;
             b->m /= RADIX;
+        } else {
+            b->exp = a->exp; // nothing left to shift out
         }
     }
 }
 
-static void normalize(NUM_T *n)
+static void fit(NUM_T *n)
 {
+    /*  Trailing zeros are kept, they are dropped in decodeNumber().  */
     if (n->m == 0) {
         setZero(n);
         return;
     }
     int8_t len = getLength(n);
-    while (len > LENGTH_MAX || n->exp < 0 && n->m % RADIX == 0) {
+    while (len > LENGTH_MAX) {
         len--;
         n->exp++;
         n->m /= RADIX;
@@ -283,28 +847,85 @@ static void normalize(NUM_T *n)
         n->exp--;
         n->m *= RADIX;
     }
-    if (len + n->exp <= 1 - LENGTH_MAX) setZero(n); // too small
+}
+
+static void checkRange(NUM_T *n)
+{
+    int8_t len = getLength(n) + n->exp;
+    if (len <= 1 - DISPLAY_MAX) setZero(n); // too small
+    if (len > DISPLAY_MAX) isError = true; // too large
+}
+
+static void squareRoot(NUM_T *n)
+{
+    /*  Newton's method from above the root, it decreases until it converges.  */
+    if (n->m <= 0) {
+        setZero(n);
+        return;
+    }
+    NUM_T x = { 1, (int8_t)((getLength(n) + n->exp + 1) / 2) };
+    NUM_T half = { RADIX / 2, -1 };
+    for (uint8_t i = 0; i < SQRT_LOOP_MAX; i++) {
+        NUM_T y = *n;
+        div(&y, &x);
+        fit(&y);
+        NUM_T t = x;
+        add(&y, &t);
+        fit(&y);
+        multi(&y, &half);
+        fit(&y);
+        t = x;
+        NUM_T u = y;
+        sub(&t, &u);
+        if (t.m <= 0) break;
+        x = y;
+    }
+    *n = x;
 }
 
 /*---------------------------------------------------------------------------*/
 /*                              Draw Functions                               */
 /*---------------------------------------------------------------------------*/
 
+static void invalidateCache(NUM_T *n)
+{
+    decodeCache[(n - stack) & CACHE_MASK][0] = CACHE_EMPTY;
+}
+
+static void copyCache(NUM_T *pDst, NUM_T *pSrc)
+{
+    uint8_t dst = pDst - stack, src = pSrc - stack;
+    if (cacheSlot[src & CACHE_MASK] != src) {
+        invalidateCache(pDst);
+        return;
+    }
+    if ((dst ^ src) & CACHE_MASK) memcpy(decodeCache[dst & CACHE_MASK], decodeCache[src & CACHE_MASK], CACHE_SIZE);
+    cacheSlot[dst & CACHE_MASK] = dst;
+}
+
 static int8_t decodeNumber(NUM_T *n)
 {
     uint8_t *pBuf = decodeBuffer;
-    int32_t m = abs(n->m);
-    int8_t len = getLength(n) + (m == 0);
+    MANT_T m = abs(n->m);
+    int8_t len = getLength(n);
     int8_t exp = n->exp;
+    if (n != pStack || !isEntering) {
+        while (exp < 0 && m % RADIX == 0) { // drop trailing zeros
+            len--;
+            exp++;
+            m /= RADIX;
+        }
+    }
+    len += (m == 0);
     if (len < 1 - exp) len = 1 - exp;
 
-    if (exp > 0) {
+    if (len + exp > DISPLAY_MAX) {
         *pBuf++ = IMG_ID_BAR;
         *pBuf++ = IMG_ID_E;
         *pBuf++ = IMG_ID_BAR;
     } else {
         while (len > 0) {
-            if (len <= LENGTH_MAX) {
+            if (len <= DISPLAY_MAX) { // lower digits beyond the display are cut
                 if (exp == 0) *pBuf++ = IMG_ID_DOT;
                 *pBuf++ = m % RADIX;
             }
@@ -319,16 +940,37 @@ static int8_t decodeNumber(NUM_T *n)
     return pBuf - decodeBuffer;
 }
 
+static int8_t decodeCachedNumber(NUM_T *n)
+{
+    uint8_t slot = n - stack;
+    uint8_t *pCache = decodeCache[slot & CACHE_MASK];
+    if (*pCache == CACHE_EMPTY || cacheSlot[slot & CACHE_MASK] != slot) {
+        cacheSlot[slot & CACHE_MASK] = slot;
+        int8_t len = decodeNumber(n);
+        for (uint8_t i = 0; i <= len; i += 2) {
+            *pCache++ = decodeBuffer[i] | decodeBuffer[i + 1] << 4;
+        }
+        return len;
+    }
+
+    uint8_t *pBuf = decodeBuffer;
+    while (true) {
+        if ((*pBuf++ = *pCache & 0x0F) == IMG_ID_MAX) break;
+        if ((*pBuf++ = *pCache++ >> 4) == IMG_ID_MAX) break;
+    }
+    return pBuf - decodeBuffer - 1;
+}
+
 static void drawStack(uint8_t *pBuffer)
 {
     int16_t x = WIDTH + IMG_SUB_PADDING;
-    for (NUM_T *n = pStack - 1; n >= &stack[0] && x >= STACK_SIZE * 2; n--) {
-        int16_t len = decodeNumber(n);
+    for (uint8_t level = NUMBER_LEVELS; level < stackDepth && x >= GAUGE_W + BATTERY_W; level++) {
+        int16_t len = decodeCachedNumber(getLevel(level));
         drawNumber(pBuffer, x, -1);
         x -= (len + 1) * (IMG_SUB_DIGIT_W + IMG_SUB_PADDING) - (IMG_SUB_DIGIT_W - IMG_SUB_DOT_W); 
     }
 
-    int8_t stackPos = &stack[STACK_SIZE - 1] - pStack;
+    int8_t stackPos = STACK_SIZE - stackDepth;
     uint8_t *p = pBuffer;
     *p++ = 0x7F;
     for (int8_t i = 0; i < STACK_SIZE - 1; i++) {
@@ -341,6 +983,22 @@ static void drawStack(uint8_t *pBuffer)
         }
     }
     *p++ = 0x7F;
+    if (isRecording) {
+        for (uint8_t *q = pBuffer; q < p; q++) *q ^= 0x7F; // invert the gauge while recording
+    }
+#ifdef BATTERY_LEVELS
+    uint8_t batteryLevel = getBatteryLevel();
+    *p++ = 0x00;
+    *p++ = 0x00;
+    *p++ = 0x7F;
+    for (uint8_t i = 0; i < BATTERY_LEVELS; i++) {
+        uint8_t c = (i < batteryLevel) ? 0x5D : 0x41;
+        *p++ = c;
+        *p++ = c;
+    }
+    *p++ = 0x7F;
+    *p = 0x1C;
+#endif
 }
 
 static void drawNumber(uint8_t *pBuffer, int16_t x, int8_t row)
@@ -349,7 +1007,7 @@ static void drawNumber(uint8_t *pBuffer, int16_t x, int8_t row)
         const uint8_t *pImg;
         int8_t w; 
         if (row >= 0) {
-            pImg = &imgDigit[*pBuf][row * IMG_DIGIT_W];
+            pImg = imgDigit[*pBuf][row];
             w = (*pBuf == IMG_ID_DOT) ? IMG_DOT_W : IMG_DIGIT_W;
             x -= IMG_PADDING;
         } else {
@@ -359,7 +1017,14 @@ static void drawNumber(uint8_t *pBuffer, int16_t x, int8_t row)
         }
         x -= w;
         if (x < 0) break;
-        memcpy_P(&pBuffer[x], pImg, w);
+        if (w == IMG_DIGIT_W) {
+            uint8_t *p = &pBuffer[x];
+            memcpy_P(p, pImg, 2);
+            memset(p + 2, pgm_read_byte(&pImg[2]), IMG_DIGIT_W - 4);
+            memcpy_P(p + IMG_DIGIT_W - 2, &pImg[3], 2);
+        } else {
+            memcpy_P(&pBuffer[x], pImg, w);
+        }
     }
 }
 
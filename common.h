@@ -5,8 +5,12 @@
 /*  Defines  */
 
 #define WIDTH       128
-#define HEIGHT      32
+#define HEIGHT      32 // 32 or 64
 #define PAGE_HEIGHT 8
+#define TEXT_MAX    12 // including the terminator
+#ifdef __AVR_ATtiny85__
+#define BATTERY_LEVELS  3
+#endif
 
 enum : uint8_t {
     BTN_NONE = 0,
@@ -29,6 +33,17 @@ enum : uint8_t {
     BTN_DIV,
     BTN_CLEAR,
     BTN_ALLCLEAR,
+    BTN_SWAP,
+    BTN_ROLL,
+    BTN_UNDO,
+    BTN_LASTX,
+    BTN_SIGMA,
+    BTN_MEAN,
+    BTN_SDEV,
+    BTN_SUM,
+    BTN_RECORD,
+    BTN_RUN,
+    BTN_SHIFT,
 };
 
 /*  Global Functions  */
@@ -37,7 +52,21 @@ void    initCore(void);
 void    refreshScreen(void (*func)(int16_t, uint8_t *));
 void    clearScreenBuffer(void);
 uint8_t getDownButton(void);
+uint8_t getSecondButton(uint8_t button); // BTN_NONE if it has none
+#ifdef __AVR_ATtiny85__
+uint8_t getBatteryLevel(void); // 0 to BATTERY_LEVELS
+bool    isSlowClock(void);
+bool    managePower(void); // true if the battery level changed
+uint8_t decodeButton(uint16_t analogValue); // of the resistor ladder
+#endif
 
 void    initCalc(void);
 bool    updateCalc(uint8_t button);
+void    saveCalc(void);
+int8_t  decodeCalc(uint8_t level, char *pText);
 void    drawCalc(int16_t y, uint8_t *pBuffer);
+
+#ifdef __AVR_ATmega32U4__
+void    initSerial(void);
+bool    handleSerial(void);
+#endif
@@ -1,3 +1,4 @@
+#include <util/delay.h>
 #include "common.h"
 
 /*  Defines  */
@@ -28,16 +29,32 @@
 #define SSD1306_ADDRESS 0x3C
 #define SSD1306_COMMAND 0x00
 #define SSD1306_DATA    0x40
+#define SSD1306_CONTRAST 0x8F
+#define SSD1306_DIMMED  0x01
+#define SSD1306_SAVING  0x2F // contrast while the battery is low
+
+#if HEIGHT != 32 && HEIGHT != 64
+    #error Sorry, Unsupported Display Height...
+#endif
 
 #ifdef ATTINY85
 #define BUTTONS_PIN     A3
-#define LONG_PRESS_BTN  BTN_CLEAR
+#define VCC_BANDGAP     1125300UL // 1.1 V * 1023 * 1000 in mV, calibrate for each chip
+#define VCC_WAIT        50  // loops between VCC samples
+#define VCC_SAVING_WAIT 300
+#define VCC_SAVING_ON   2700 // mV
+#define VCC_SAVING_OFF  2800
 #else
 #define BUTTON_ROWS     4
 #define BUTTON_COLS     4
-#define LONG_PRESS_BTN  BTN_ENTER
 #endif
-#define LONG_PRESS_WAIT 5
+#define SHIFT_MARK      0x80 // underline of the top page while shifted
+#ifndef ATTINY85
+#define LONG_PRESS_WAIT 5   // loops of Enter held to shift
+#endif
+#define DIM_WAIT        200 // loops without any button
+#define SLEEP_WAIT      600
+//#define PASS_WAKE_BUTTON  // The button which wakes the screen up also acts
 
 /*  Macro functions  */
 
@@ -45,30 +62,41 @@
 #define getThresholdFromInfo(info)  ((info) >> 5)
 #define getButtonFromInfo(info)     ((info) & 0x1F)
 
+/*  Local Functions  */
+
+static const uint8_t *getScreenSegment(uint8_t idx, uint8_t &len);
+static bool     manageIdle(uint8_t currentButton);
+static void     setContrast(uint8_t value);
+#ifdef ATTINY85
+static uint16_t readVcc(void);
+static void     setClock(void);
+#endif
+
 /*  Local Variables  */
 
 PROGMEM static const uint8_t ssd1306InitSequence[] = { // Initialization Sequence
     SSD1306_COMMAND,
-    0xAE,           // Set Display ON/OFF - AE=OFF, AF=ON
+    // Display offset, start line, pre-charge period, Vcomh level, entire display ON,
+    // normal display and scroll deactivation are left at their reset values.
     0xD5, 0xF0,     // Set display clock divide ratio/oscillator frequency, set divide ratio
-    0xA8, 0x1F,     // Set multiplex ratio (1 to 64) ... (height - 1)
-    0xD3, 0x00,     // Set display offset. 00 = no offset
-    0x40 | 0x00,    // Set start line address, at 0.
+    0xA8, HEIGHT - 1, // Set multiplex ratio (1 to 64) ... (height - 1)
     0x8D, 0x14,     // Charge Pump Setting, 14h = Enable Charge Pump
     0x20, 0x00,     // Set Memory Addressing Mode - 00=Horizontal, 01=Vertical, 10=Page, 11=Invalid
-    0x22, 0x00, 0x03, // Set Page Address, start page 0, end page 3
+    0x21, 0x00, 0x7F, // Set Column Address, start column 0, end column 127
+    0x22, 0x00, HEIGHT / PAGE_HEIGHT - 1, // Set Page Address, start page 0, end page 3 or 7
     0xA0 | 0x01,    // Set Segment Re-map
     0xC8,           // Set COM Output Scan Direction
-    0xDA, 0x02,     // Set COM Pins Hardware Configuration - 128x32:0x02, 128x64:0x12
-    0x81, 0x8F,     // Set contrast control register
-    0xD9, 0x22,     // Set pre-charge period (0x22 or 0xF1)
-    0xDB, 0x20,     // Set Vcomh Deselect Level - 0x00: 0.65 x VCC, 0x20: 0.77 x VCC (RESET), 0x30: 0.83 x VCC
-    0xA4,           // Entire Display ON (resume) - output RAM to display
-    0xA6,           // Set Normal/Inverse Display mode. A6=Normal; A7=Inverse
-    0x2E,           // Deactivate Scroll command
+    0xDA, (HEIGHT == 64) ? 0x12 : 0x02, // Set COM Pins Hardware Configuration - 128x32:0x02, 128x64:0x12
+    0x81, SSD1306_CONTRAST, // Set contrast control register
     0xAF,           // Set Display ON/OFF - AE=OFF, AF=ON
-    0xB0,           // Set page start, at 0.
-    0x00, 0x10,     // Set column start, at 0.
+};
+
+PROGMEM static const uint8_t ssd1306SleepSequence[] = { // GRAM is retained while sleeping
+    SSD1306_COMMAND, 0xAE, 0x8D, 0x10,
+};
+
+PROGMEM static const uint8_t ssd1306WakeSequence[] = {
+    SSD1306_COMMAND, 0x8D, 0x14, 0xAF,
 };
 
 #ifdef ATTINY85
@@ -79,8 +107,10 @@ PROGMEM static const uint16_t buttonInfoTable[] = {
     buttonInfo(BTN_MULTI,479),  buttonInfo(BTN_6,    393),  buttonInfo(BTN_5,     316),
     buttonInfo(BTN_4,    249),  buttonInfo(BTN_7,    189),  buttonInfo(BTN_8,     134),
     buttonInfo(BTN_9,    87 ),  buttonInfo(BTN_DIV,  49 ),  buttonInfo(BTN_CLEAR, 15 ),
-    buttonInfo(BTN_INVERT,0 ),
+    buttonInfo(BTN_SHIFT, 0 ),
 };
+
+PROGMEM static const uint16_t batteryLevelTable[BATTERY_LEVELS] = { 2600, 2750, 2900 }; // mV
 #else
 PROGMEM static const uint8_t buttonPinCol[BUTTON_COLS] = { 5, 4, 0, 1 };
 PROGMEM static const uint8_t buttonPinRow[BUTTON_ROWS] = { 9, 8, 7, 6 };
@@ -92,8 +122,38 @@ PROGMEM static const uint8_t buttonTable[BUTTON_ROWS][BUTTON_COLS] = {
 };
 #endif
 
+PROGMEM static const uint8_t secondTable[][2] = { // Button, function after shift
+#ifdef ATTINY85
+    { BTN_SHIFT, BTN_INVERT   },
+    { BTN_CLEAR, BTN_ALLCLEAR },
+    { BTN_ENTER, BTN_SWAP     },
+    { BTN_DIV,   BTN_ROLL     },
+#else
+    { BTN_ENTER, BTN_ALLCLEAR },
+    { BTN_DIV,   BTN_SWAP     },
+    { BTN_MULTI, BTN_ROLL     },
+#endif
+    { BTN_MINUS, BTN_UNDO     },
+    { BTN_PLUS,  BTN_LASTX    },
+    { BTN_1,     BTN_SIGMA    },
+    { BTN_2,     BTN_MEAN     },
+    { BTN_3,     BTN_SDEV     },
+    { BTN_4,     BTN_SUM      },
+    { BTN_DOT,   BTN_RECORD   },
+    { BTN_0,     BTN_RUN      },
+};
+
 static uint8_t  lastButton;
+static uint16_t idleCounter;
+static uint8_t  contrast = SSD1306_CONTRAST;
+#ifdef ATTINY85
+static uint8_t  batteryLevel = BATTERY_LEVELS;
+static uint8_t  clockPrescale; // set by the boot code
+static bool     isSaving;
+#endif
+static bool     isShifted, isMarkStale;
 static uint8_t  wireBuffer[WIDTH + 1];
+static void     (*drawFunc)(int16_t, uint8_t *);
 
 /*---------------------------------------------------------------------------*/
 
@@ -101,12 +161,12 @@ void initCore(void)
 {
     // Setup display
     SIMPLEWIRE::begin();
-    memcpy_P(wireBuffer, ssd1306InitSequence, sizeof(ssd1306InitSequence));
-    SIMPLEWIRE::write(SSD1306_ADDRESS, wireBuffer, sizeof(ssd1306InitSequence));
+    SIMPLEWIRE::write_P(SSD1306_ADDRESS, ssd1306InitSequence, sizeof(ssd1306InitSequence));
 
     // Setup buttons
 #ifdef ATTINY85
     pinMode(BUTTONS_PIN, INPUT);
+    clockPrescale = CLKPR;
 #else
     for (uint8_t row = 0; row < BUTTON_ROWS; row++) {
         uint8_t pin = pgm_read_byte(&buttonPinRow[row]);
@@ -123,10 +183,9 @@ void initCore(void)
 void refreshScreen(void (*func)(int16_t, uint8_t *))
 {
     wireBuffer[0] = SSD1306_DATA;
-    for (int16_t y = 0; y < HEIGHT; y += PAGE_HEIGHT) {
-        (func) ? func(y, &wireBuffer[1]) : clearScreenBuffer();
-        SIMPLEWIRE::write(SSD1306_ADDRESS, wireBuffer, WIDTH + 1);
-    }
+    drawFunc = func;
+    isMarkStale = false;
+    SIMPLEWIRE::write(SSD1306_ADDRESS, getScreenSegment); // whole frame in one transaction
 }
 
 void clearScreenBuffer(void)
@@ -134,20 +193,66 @@ void clearScreenBuffer(void)
     memset(&wireBuffer[1], 0, WIDTH);
 }
 
-uint8_t getDownButton(void)
-{
-    uint8_t currentButton;
 #ifdef ATTINY85
-    uint16_t analogValue = analogRead(BUTTONS_PIN);
+uint8_t getBatteryLevel(void)
+{
+    return batteryLevel;
+}
+
+bool isSlowClock(void)
+{
+    return isSaving;
+}
+
+bool managePower(void)
+{
+    /*  Sample VCC under the load of the screen and save power as the cell sags.  */
+    static uint16_t vccCounter = 0;
+    if (idleCounter >= SLEEP_WAIT) return false;
+    if (vccCounter > 0) {
+        vccCounter--;
+        return false;
+    }
+    uint16_t vcc = readVcc();
+    if (isSaving ? vcc >= VCC_SAVING_OFF : vcc < VCC_SAVING_ON) {
+        isSaving = !isSaving;
+        setClock();
+        contrast = (isSaving) ? SSD1306_SAVING : SSD1306_CONTRAST;
+        if (idleCounter < DIM_WAIT) setContrast(contrast);
+    }
+    vccCounter = (isSaving) ? VCC_SAVING_WAIT : VCC_WAIT;
+
+    uint8_t level = 0;
+    while (level < BATTERY_LEVELS && vcc >= pgm_read_word(&batteryLevelTable[level])) level++;
+    if (level == batteryLevel) return false;
+    batteryLevel = level;
+    return true; // the caller refreshes the screen with the new level
+}
+
+uint8_t decodeButton(uint16_t analogValue)
+{
     for (uint8_t i = 0; i < sizeof(buttonInfoTable) / 2; i++) {
         uint16_t buttonInfo = pgm_read_word(&buttonInfoTable[i]);
-        if (analogValue >= getThresholdFromInfo(buttonInfo)) {
-            currentButton = getButtonFromInfo(buttonInfo);
-            break;
-        }
+        if (analogValue >= getThresholdFromInfo(buttonInfo)) return getButtonFromInfo(buttonInfo);
+    }
+    return BTN_NONE; // never, the last threshold is 0
+}
+#endif
+
+uint8_t getSecondButton(uint8_t button)
+{
+    for (uint8_t i = 0; i < sizeof(secondTable) / 2; i++) {
+        if (pgm_read_byte(&secondTable[i][0]) == button) return pgm_read_byte(&secondTable[i][1]);
     }
+    return BTN_NONE;
+}
+
+uint8_t getDownButton(void)
+{
+#ifdef ATTINY85
+    uint8_t currentButton = decodeButton(analogRead(BUTTONS_PIN)); // ratiometric, so VCC doesn't move the thresholds
 #else
-    currentButton = BTN_NONE;
+    uint8_t currentButton = BTN_NONE;
     for (uint8_t row = 0; currentButton == BTN_NONE && row < BUTTON_ROWS; row++) {
         uint8_t pin = pgm_read_byte(&buttonPinRow[row]);
         digitalWrite(pin, LOW);
@@ -160,17 +265,117 @@ uint8_t getDownButton(void)
     }
 #endif
 
-    static uint8_t pressCounter = 0;
-    if (currentButton == LONG_PRESS_BTN && lastButton == LONG_PRESS_BTN) {
-        if (++pressCounter == LONG_PRESS_WAIT) {
-            lastButton = BTN_NONE;
-            currentButton = BTN_ALLCLEAR;
+    bool isPassed = manageIdle(currentButton);
+    uint8_t downButton = BTN_NONE;
+    if (isMarkStale) refreshScreen(drawFunc); // the shifted button didn't change the screen
+#ifndef ATTINY85
+    /*  Enter held long is the shift, so only Enter waits to act until it is released.  */
+    static uint8_t pressCounter = LONG_PRESS_WAIT;
+    if (pressCounter < LONG_PRESS_WAIT) {
+        if (currentButton != BTN_ENTER) {
+            downButton = BTN_ENTER;
+            pressCounter = LONG_PRESS_WAIT;
+        } else if (++pressCounter == LONG_PRESS_WAIT) {
+            isShifted = true;
+            refreshScreen(drawFunc);
         }
-    } else {
-        pressCounter = 0;
     }
+#endif
 
-    uint8_t downButton = (lastButton == BTN_NONE) ? currentButton : BTN_NONE;
+    /*  Every other button acts when it is pressed, the shift selects the second function.  */
+    if (isPassed && lastButton == BTN_NONE && currentButton != BTN_NONE) {
+        if (isShifted) {
+            downButton = getSecondButton(currentButton);
+            if (downButton == BTN_NONE) downButton = currentButton;
+            isShifted = false;
+            isMarkStale = true;
+#ifdef ATTINY85
+        } else if (currentButton == BTN_SHIFT) {
+            isShifted = true;
+            refreshScreen(drawFunc);
+#else
+        } else if (currentButton == BTN_ENTER) {
+            pressCounter = 0;
+#endif
+        } else {
+            downButton = currentButton;
+        }
+    }
     lastButton = currentButton;
     return downButton;
 }
+
+/*---------------------------------------------------------------------------*/
+
+static const uint8_t *getScreenSegment(uint8_t idx, uint8_t &len)
+{
+    int16_t y = idx * PAGE_HEIGHT;
+    if (y >= HEIGHT) return NULL;
+    (drawFunc) ? drawFunc(y, &wireBuffer[1]) : clearScreenBuffer();
+    if (idx == 0 && isShifted) {
+        for (uint8_t i = 1; i <= WIDTH; i++) wireBuffer[i] |= SHIFT_MARK;
+    }
+    if (idx == 0) {
+        len = WIDTH + 1; // lead with the control byte
+        return &wireBuffer[0];
+    }
+    len = WIDTH;
+    return &wireBuffer[1];
+}
+
+static bool manageIdle(uint8_t currentButton)
+{
+    /*  Dim and then sleep the screen while no button is pressed.  */
+    static bool     isWaking = false;
+    bool isPassed = !isWaking;
+    if (currentButton == BTN_NONE) {
+        if (idleCounter < SLEEP_WAIT) {
+            if (++idleCounter == DIM_WAIT) {
+                setContrast(SSD1306_DIMMED);
+            } else if (idleCounter == SLEEP_WAIT) {
+                SIMPLEWIRE::write_P(SSD1306_ADDRESS, ssd1306SleepSequence, sizeof(ssd1306SleepSequence));
+            }
+        }
+        isWaking = false;
+    } else {
+        if (idleCounter >= SLEEP_WAIT) {
+            SIMPLEWIRE::write_P(SSD1306_ADDRESS, ssd1306WakeSequence, sizeof(ssd1306WakeSequence));
+            setContrast(contrast);
+#ifndef PASS_WAKE_BUTTON
+            isWaking = true; // consume the button until it is released
+            isPassed = false;
+#endif
+        } else if (idleCounter >= DIM_WAIT) {
+            setContrast(contrast);
+        }
+        idleCounter = 0;
+    }
+    return isPassed;
+}
+
+static void setContrast(uint8_t value)
+{
+    uint8_t sequence[] = { SSD1306_COMMAND, 0x81, value };
+    SIMPLEWIRE::write(SSD1306_ADDRESS, sequence, sizeof(sequence));
+}
+
+#ifdef ATTINY85
+static uint16_t readVcc(void)
+{
+    ADMUX = _BV(MUX3) | _BV(MUX2); // measure the bandgap against VCC
+    _delay_ms(1); // let the bandgap settle
+    ADCSRA |= _BV(ADSC);
+    while (bit_is_set(ADCSRA, ADSC)) ;
+    return VCC_BANDGAP / ADC; // analogRead() selects its pin again
+}
+
+static void setClock(void)
+{
+    /*  Halving the clock keeps the chip in its safe operating area at low VCC.  */
+    uint8_t prescale = (isSaving) ? clockPrescale + 1 : clockPrescale;
+    cli();
+    CLKPR = _BV(CLKPCE);
+    CLKPR = prescale;
+    sei();
+}
+#endif
@@ -17,64 +17,69 @@ enum : uint8_t {
     IMG_ID_MAX
 };
 
+PROGMEM static const char imgText[] = "0123456789-E."; // character for each image ID
+
 #define IMG_DIGIT_W 12
 #define IMG_DIGIT_H 24
+#define IMG_DIGIT_COLS 5
 #define IMG_DOT_W   2
 #define IMG_PADDING 2
 
-PROGMEM static const uint8_t imgDigit[][36] = { // 12x24 x13
+/*  Each row of a digit image is stored as 5 columns: left 2 columns, a middle
+    column which is repeated (IMG_DIGIT_W - 4) times and right 2 columns.  */
+PROGMEM static const uint8_t imgDigit[][IMG_DIGIT_H / 8][IMG_DIGIT_COLS] = { // 12x24 x13
     {
-        0xF8, 0xF4, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0xF4, 0xF8,
-        0xDF, 0x8F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC7, 0xEF,
-        0x7F, 0xBF, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xBF, 0x7F // '0'
-    },{
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0xF8,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC7, 0xEF,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x7F // '1'
-    },{
-        0x00, 0x04, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0xF4, 0xF8,
-        0xC0, 0xA0, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x17, 0x0F,
-        0x7F, 0xBF, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x80, 0x00 // '2'
-    },{
-        0x00, 0x04, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0xF4, 0xF8,
-        0x00, 0x20, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xD7, 0xEF,
-        0x00, 0x80, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xBF, 0x7F // '3'
-    },{
-        0xF8, 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0xF8,
-        0x1F, 0x2F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xD7, 0xEF,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x7F // '4'
-    },{
-        0xF8, 0xF4, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x04, 0x00,
-        0x1F, 0x2F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xD0, 0xE0,
-        0x00, 0x80, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xBF, 0x7F // '5'
-    },{
-        0xF8, 0xF4, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x04, 0x00,
-        0xDF, 0xAF, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xD0, 0xE0,
-        0x7F, 0xBF, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xBF, 0x7F // '6'
-    },{
-        0xF8, 0xF4, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0xF4, 0xF8,
-        0x1F, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC7, 0xEF,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x7F // '7'
-    },{
-        0xF8, 0xF4, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0xF4, 0xF8,
-        0xDF, 0xAF, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xD7, 0xEF,
-        0x7F, 0xBF, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xBF, 0x7F // '8'
-    },{
-        0xF8, 0xF4, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0xF4, 0xF8,
-        0x1F, 0x2F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xD7, 0xEF,
-        0x00, 0x80, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xBF, 0x7F // '9'
-    },{
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x20, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x10, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 // '-'
-    },{
-        0xF8, 0xF4, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x04, 0x00,
-        0xDF, 0xAF, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x10, 0x00,
-        0x7F, 0xBF, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x80, 0x00 // 'E'
+        { 0xF8, 0xF4, 0x0C, 0xF4, 0xF8 },
+        { 0xDF, 0x8F, 0x00, 0xC7, 0xEF },
+        { 0x7F, 0xBF, 0xC0, 0xBF, 0x7F } // '0'
+    }, {
+        { 0x00, 0x00, 0x00, 0xF0, 0xF8 },
+        { 0x00, 0x00, 0x00, 0xC7, 0xEF },
+        { 0x00, 0x00, 0x00, 0x3F, 0x7F } // '1'
+    }, {
+        { 0x00, 0x04, 0x0C, 0xF4, 0xF8 },
+        { 0xC0, 0xA0, 0x30, 0x17, 0x0F },
+        { 0x7F, 0xBF, 0xC0, 0x80, 0x00 } // '2'
+    }, {
+        { 0x00, 0x04, 0x0C, 0xF4, 0xF8 },
+        { 0x00, 0x20, 0x30, 0xD7, 0xEF },
+        { 0x00, 0x80, 0xC0, 0xBF, 0x7F } // '3'
+    }, {
+        { 0xF8, 0xF0, 0x00, 0xF0, 0xF8 },
+        { 0x1F, 0x2F, 0x30, 0xD7, 0xEF },
+        { 0x00, 0x00, 0x00, 0x3F, 0x7F } // '4'
+    }, {
+        { 0xF8, 0xF4, 0x0C, 0x04, 0x00 },
+        { 0x1F, 0x2F, 0x30, 0xD0, 0xE0 },
+        { 0x00, 0x80, 0xC0, 0xBF, 0x7F } // '5'
+    }, {
+        { 0xF8, 0xF4, 0x0C, 0x04, 0x00 },
+        { 0xDF, 0xAF, 0x30, 0xD0, 0xE0 },
+        { 0x7F, 0xBF, 0xC0, 0xBF, 0x7F } // '6'
+    }, {
+        { 0xF8, 0xF4, 0x0C, 0xF4, 0xF8 },
+        { 0x1F, 0x0F, 0x00, 0xC7, 0xEF },
+        { 0x00, 0x00, 0x00, 0x3F, 0x7F } // '7'
+    }, {
+        { 0xF8, 0xF4, 0x0C, 0xF4, 0xF8 },
+        { 0xDF, 0xAF, 0x30, 0xD7, 0xEF },
+        { 0x7F, 0xBF, 0xC0, 0xBF, 0x7F } // '8'
+    }, {
+        { 0xF8, 0xF4, 0x0C, 0xF4, 0xF8 },
+        { 0x1F, 0x2F, 0x30, 0xD7, 0xEF },
+        { 0x00, 0x80, 0xC0, 0xBF, 0x7F } // '9'
+    }, {
+        { 0x00, 0x00, 0x00, 0x00, 0x00 },
+        { 0x00, 0x20, 0x30, 0x10, 0x00 },
+        { 0x00, 0x00, 0x00, 0x00, 0x00 } // '-'
+    }, {
+        { 0xF8, 0xF4, 0x0C, 0x04, 0x00 },
+        { 0xDF, 0xAF, 0x30, 0x10, 0x00 },
+        { 0x7F, 0xBF, 0xC0, 0x80, 0x00 } // 'E'
     }, {
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0xE0, 0xE0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 // '.'
+        { 0x00, 0x00, 0x00, 0x00, 0x00 },
+        { 0x00, 0x00, 0x00, 0x00, 0x00 },
+        { 0xE0, 0xE0, 0x00, 0x00, 0x00 } // '.'
     }
 };
 
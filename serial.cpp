@@ -0,0 +1,116 @@
+/*
+  Serial command channel on the USB serial of ATmega32U4
+
+  Each received byte is one command, keys are evaluated as they arrive
+  and the screen is refreshed once after the stream pauses.
+
+    0-9 .     Digit and dot keys
+    E         Enter
+    N         Invert sign
+    + - * /   Operators
+    C         Clear
+    A         All clear
+    X         Swap
+    R         Roll down
+    U         Undo
+    L         Last x
+    S         Add to the statistics
+    M D T     Mean, standard deviation and sum
+    P         Start or stop recording a program
+    G         Run the recorded program
+    0x80|n    Button code n of common.h as it is
+
+    LF        Reply the top of the stack as the screen shows it
+    ?         Reply all numbers of the stack from the top, then an empty line
+
+  CR, space and tab are ignored, any other byte is replied with "!".
+  e.g. "1E3/\n" is replied with "0.3333333".
+*/
+
+#include "common.h"
+
+#ifdef __AVR_ATmega32U4__
+
+#include <util/delay.h>
+
+/*  Defines  */
+
+#define SERIAL_BAUD     115200 // ignored by USB CDC
+#define SERIAL_GAP_US   100
+#define SERIAL_GAP_MAX  20  // the stream pauses after 2 milliseconds
+#define RAW_BUTTON      0x80
+
+/*  Local Functions  */
+
+static uint8_t  getSerialButton(uint8_t c);
+static bool     replyLevel(uint8_t level);
+
+/*  Local Variables  */
+
+PROGMEM static const char serialButtonTable[][2] = { // Character, button
+    { 'E', BTN_ENTER  }, { 'N', BTN_INVERT   }, { '+', BTN_PLUS   }, { '-', BTN_MINUS  },
+    { '*', BTN_MULTI  }, { '/', BTN_DIV      }, { 'C', BTN_CLEAR  }, { 'A', BTN_ALLCLEAR },
+    { 'X', BTN_SWAP   }, { 'R', BTN_ROLL     }, { 'U', BTN_UNDO   }, { 'L', BTN_LASTX  },
+    { 'S', BTN_SIGMA  }, { 'M', BTN_MEAN     }, { 'D', BTN_SDEV   }, { 'T', BTN_SUM    },
+    { 'P', BTN_RECORD }, { 'G', BTN_RUN      }, { '.', BTN_DOT    },
+};
+
+/*---------------------------------------------------------------------------*/
+
+void initSerial(void)
+{
+    Serial.begin(SERIAL_BAUD);
+}
+
+bool handleSerial(void)
+{
+    bool isInvalid = false;
+    if (Serial.available() <= 0) return false;
+    for (uint8_t gap = 0; gap < SERIAL_GAP_MAX; ) {
+        int16_t c = Serial.read();
+        if (c < 0) {
+            _delay_us(SERIAL_GAP_US);
+            gap++;
+            continue;
+        }
+        gap = 0;
+        uint8_t button = getSerialButton(c);
+        if (button != BTN_NONE) {
+            isInvalid |= updateCalc(button);
+        } else if (c == '\n') {
+            replyLevel(0);
+        } else if (c == '?') {
+            for (uint8_t level = 0; replyLevel(level); level++) { ; }
+            Serial.write('\n');
+        } else if (c != '\r' && c != ' ' && c != '\t') {
+            Serial.print("!\n");
+        }
+    }
+    return isInvalid;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static uint8_t getSerialButton(uint8_t c)
+{
+    if (c >= '0' && c <= '9') return BTN_0 + c - '0';
+    if (c & RAW_BUTTON) {
+        c &= ~RAW_BUTTON;
+        return (c <= BTN_RUN) ? c : (uint8_t)BTN_NONE;
+    }
+    for (uint8_t i = 0; i < sizeof(serialButtonTable) / 2; i++) {
+        if (pgm_read_byte(&serialButtonTable[i][0]) == c) return pgm_read_byte(&serialButtonTable[i][1]);
+    }
+    return BTN_NONE;
+}
+
+static bool replyLevel(uint8_t level)
+{
+    char text[TEXT_MAX];
+    if (decodeCalc(level, text) < 0) return false;
+    Serial.print(text);
+    Serial.write('\n');
+    return true;
+}
+
+#endif
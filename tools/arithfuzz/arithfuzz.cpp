@@ -0,0 +1,504 @@
+/*
+  arithfuzz - Differential fuzzing of the arithmetic of calc.cpp
+
+  Build on a host (from the top of the repository):
+
+    c++ -O2 -I tools/rpneval -o arithfuzz tools/arithfuzz/arithfuzz.cpp calc.cpp
+
+  or as a libFuzzer target, which feeds the bytes as keystrokes:
+
+    clang++ -O1 -g -fsanitize=fuzzer,address -DFUZZING -I tools/rpneval \
+        -o arithfuzz tools/arithfuzz/arithfuzz.cpp calc.cpp
+
+  Usage:
+
+    arithfuzz [options]
+
+  Operand pairs are typed with the digit keys, e.g. "12.5 ENTER 0.003 /",
+  and the result shown on the screen is compared with the exact value of
+  the operation. The exact value is kept as a fraction of 128-bit integers
+  in units of 1e-14, which holds every product and quotient of the numbers
+  that can be typed. The error is measured in units of the last place of
+  the screen, the 8th digit of the exact value or 1e-7 below 1. An error of
+  1 or more is a failure, as well as a wrong -E-. The results above the
+  exact value in magnitude are counted too, since the engine truncates; an
+  add or subtract can only be above by the digits cut off the smaller
+  operand.
+
+  A quotient is also added or subtracted by zero before it is multiplied,
+  e.g. "1 ENTER 3 / 0 + 7 *", which has to give the same as without the
+  zero. It keeps the digits cut off the screen, which surface in the
+  product.
+
+  Random keystroke sequences then run through the engine. Each operator is
+  checked against the exact value of its operands as they are shown, when
+  no digit of them is cut off the screen, as well as the stack depth, the
+  text of every level and the restore by an undo right after it.
+
+  The exit status is 1 if any check fails.
+
+    -n n      Operand pairs per operator (250000)
+    -k n      Keystrokes of the random sequences (1000000)
+    -s n      Seed (1)
+    -v        Print each failure
+*/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <chrono>
+#include "tokens.h"
+
+/*  Defines  */
+
+#define DISPLAY_MAX 8
+#define LEVEL_MAX   16 // STACK_SIZE of calc.cpp
+#define SCALE       10000000LL // of the text, 1e-7
+#define OPS         4
+#define HIST_SIZE   5
+#define SEQ_MAX     32
+#define PRINT_MAX   20
+
+/*  Typedefs  */
+
+typedef __int128 BIG_T;
+
+typedef struct {
+    BIG_T   p, q; // p / q in units of 1e-14, q > 0
+} EXACT_T;
+
+typedef struct {
+    long    count, hist[HIST_SIZE], errors, above, range;
+    double  maxUlp;
+} STAT_T;
+
+/*  Local Functions  */
+
+static bool     checkSequence(const uint8_t *pKeys, long count);
+static bool     checkResult(uint8_t op, BIG_T a, BIG_T b, const char *pText, STAT_T *pStat);
+static EXACT_T  getExact(uint8_t op, BIG_T a, BIG_T b);
+static bool     parseText(const char *pText, BIG_T *pValue);
+static bool     isShownInFull(const char *pText);
+static bool     isWellFormed(const char *pText);
+static int8_t   getDepth(void);
+static void     reportFailure(const char *pFormat, ...);
+#ifndef FUZZING
+static bool     checkPair(uint8_t op, const char *pA, const char *pB);
+static bool     checkZero(const char *pA, const char *pB, const char *pC);
+static void     typeNumber(const char *pText);
+static void     makeNumber(char *pText);
+static uint8_t  makeKey(void);
+static uint64_t getRandom(void);
+static void     printStat(const char *pName, const STAT_T *pStat);
+#endif
+
+/*  Local Variables  */
+
+static const char opNames[OPS] = { '+', '-', '*', '/' };
+
+static STAT_T   seqStat[OPS];
+static bool     isVerbose;
+#ifndef FUZZING
+static const char *histNames[HIST_SIZE] = { "exact", "<1", "<2", "<10", "more" };
+static STAT_T   pairStat[OPS];
+static uint64_t seed = 1;
+static long     failures, zeroCount, zeroFailures;
+static double   engineTime;
+#endif
+
+/*---------------------------------------------------------------------------*/
+
+void clearScreenBuffer(void)
+{
+    // Nothing is rendered
+}
+
+#ifdef BATTERY_LEVELS
+uint8_t getBatteryLevel(void)
+{
+    return BATTERY_LEVELS;
+}
+#endif
+
+#ifdef FUZZING
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static bool isInitialized;
+    static uint8_t keys[4096];
+    if (!isInitialized) {
+        initCalc();
+        isInitialized = true;
+    }
+    if (size > sizeof(keys)) size = sizeof(keys);
+    for (size_t i = 0; i < size; i++) keys[i] = data[i] % BTN_SHIFT;
+    updateCalc(BTN_ALLCLEAR);
+    if (!checkSequence(keys, size)) abort();
+    return 0;
+}
+
+#else
+
+int main(int argc, char *argv[])
+{
+    static char textA[TEXT_MAX], textB[TEXT_MAX], textC[TEXT_MAX];
+    static uint8_t keys[SEQ_MAX];
+    long pairs = 250000, keyCount = 1000000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:k:s:v")) != -1) {
+        if (opt == 'n') pairs = atol(optarg);
+        else if (opt == 'k') keyCount = atol(optarg);
+        else if (opt == 's') seed = strtoull(optarg, NULL, 0);
+        else if (opt == 'v') isVerbose = true;
+        else return 2;
+    }
+    if (seed == 0) seed = 1;
+
+    initCalc();
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < pairs; i++) {
+        for (uint8_t op = 0; op < OPS; op++) {
+            makeNumber(textA);
+            makeNumber(textB);
+            if (!checkPair(op, textA, textB)) failures++;
+        }
+        makeNumber(textC);
+        if (!checkZero(textA, textB, textC)) failures++;
+    }
+    double pairTime = engineTime;
+    updateCalc(BTN_ALLCLEAR);
+    for (long i = 0; i < keyCount; i += SEQ_MAX) {
+        for (uint8_t j = 0; j < SEQ_MAX; j++) keys[j] = makeKey();
+        if (!checkSequence(keys, SEQ_MAX)) failures++;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    printf("op  %-9s", "count");
+    for (uint8_t i = 0; i < HIST_SIZE; i++) printf(" %8s", histNames[i]);
+    printf(" %7s %7s %7s %9s\n", "-E-", "above", "range", "max ulp");
+    for (uint8_t op = 0; op < OPS; op++) {
+        char name[8] = { opNames[op], '\0' };
+        printStat(name, &pairStat[op]);
+    }
+    for (uint8_t op = 0; op < OPS; op++) {
+        char name[8] = { opNames[op], ' ', 's', 'e', 'q', '\0' };
+        printStat(name, &seqStat[op]);
+    }
+    printf("zero %ld checked, %ld differ\n", zeroCount, zeroFailures);
+    if (pairTime > 0) printf("%.0f operations per second in the engine\n", pairs * OPS / pairTime);
+    printf("%.1f s in total, %ld failures\n", elapsed.count(), failures);
+    return (failures == 0) ? 0 : 1;
+}
+
+#endif
+
+/*---------------------------------------------------------------------------*/
+
+static bool checkSequence(const uint8_t *pKeys, long count)
+{
+    static char before[LEVEL_MAX][TEXT_MAX], after[LEVEL_MAX][TEXT_MAX], operands[2][TEXT_MAX];
+    bool isGood = true, isUndoable = false;
+    int8_t depth = getDepth();
+    for (long i = 0; i < count; i++) {
+        uint8_t key = pKeys[i];
+        for (int8_t level = 0; level < depth; level++) decodeCalc(level, before[level]);
+        updateCalc(key);
+        int8_t newDepth = getDepth();
+        for (int8_t level = 0; level < newDepth; level++) {
+            decodeCalc(level, after[level]);
+            if (!isWellFormed(after[level])) {
+                reportFailure("malformed \"%s\" at level %d\n", after[level], level);
+                isGood = false;
+            }
+        }
+
+        bool isOperated = (key >= BTN_PLUS && key <= BTN_DIV && depth > 1 && strcmp(before[0], "-E-") != 0);
+        if (isOperated) {
+            uint8_t op = key - BTN_PLUS;
+            BIG_T a, b;
+            if (newDepth != depth - 1) {
+                reportFailure("depth %d after %s ENTER %s %c\n", newDepth, before[1], before[0], opNames[op]);
+                isGood = false;
+            }
+            for (int8_t level = 1; level < newDepth && level + 1 < depth; level++) {
+                if (strcmp(after[level], before[level + 1]) != 0) {
+                    reportFailure("level %d became %s after %c\n", level + 1, after[level], opNames[op]);
+                    isGood = false;
+                }
+            }
+            if (isShownInFull(before[1]) && isShownInFull(before[0]) &&
+                    parseText(before[1], &a) && parseText(before[0], &b) &&
+                    !checkResult(op, a, b, after[0], &seqStat[op])) {
+                reportFailure("%s ENTER %s %c = %s\n", before[1], before[0], opNames[op], after[0]);
+                isGood = false;
+            }
+            memcpy(operands[0], before[0], TEXT_MAX);
+            memcpy(operands[1], before[1], TEXT_MAX);
+        } else if (key == BTN_UNDO && isUndoable) {
+            /*  Undo right after an operator brings back both operands.  */
+            bool isRestored = (newDepth == depth + 1);
+            for (int8_t level = 0; level < 2 && isRestored; level++) {
+                BIG_T x, y;
+                isRestored = (strcmp(after[level], operands[level]) == 0 ||
+                        (parseText(after[level], &x) && parseText(operands[level], &y) && x == y));
+            }
+            if (!isRestored) {
+                reportFailure("undo gave %s ENTER %s for %s ENTER %s\n", after[1], after[0], operands[1], operands[0]);
+                isGood = false;
+            }
+        }
+        isUndoable = isOperated;
+        depth = newDepth;
+    }
+    return isGood;
+}
+
+static bool checkResult(uint8_t op, BIG_T a, BIG_T b, const char *pText, STAT_T *pStat)
+{
+    pStat->count++;
+    EXACT_T e = getExact(op, a, b);
+    bool isError = (strcmp(pText, "-E-") == 0);
+    if (e.q == 0) { // divided by zero
+        if (isError) {
+            pStat->errors++;
+            return true;
+        }
+        pStat->range++;
+        return false;
+    }
+
+    BIG_T absP = (e.p < 0) ? -e.p : e.p;
+    BIG_T intPart = absP / (e.q * SCALE * SCALE);
+    uint8_t intLen = 0;
+    for (BIG_T i = intPart; i > 0; i /= 10) intLen++;
+    BIG_T ulp = SCALE; // 1e-7 below 1, 10^(intLen - 8) above
+    for (uint8_t i = 1; i < intLen; i++) ulp *= 10;
+    if (intLen > DISPLAY_MAX || isError) {
+        if (intLen > DISPLAY_MAX && isError) {
+            pStat->errors++;
+            return true;
+        }
+        pStat->range++;
+        return false;
+    }
+
+    BIG_T shown;
+    if (!parseText(pText, &shown)) {
+        pStat->range++;
+        return false;
+    }
+    BIG_T diff = shown * SCALE * e.q - e.p;
+    bool isAbove = (e.p >= 0) ? diff > 0 : diff < 0;
+    if (diff < 0) diff = -diff;
+    double errorUlp = (double)((long double)diff / (long double)(e.q * ulp));
+    if (errorUlp > pStat->maxUlp) pStat->maxUlp = errorUlp;
+    pStat->hist[(diff == 0) ? 0 : (errorUlp < 1) ? 1 : (errorUlp < 2) ? 2 : (errorUlp < 10) ? 3 : 4]++;
+    if (isAbove) pStat->above++;
+    return errorUlp < 1;
+}
+
+static EXACT_T getExact(uint8_t op, BIG_T a, BIG_T b)
+{
+    /*  The operands are in units of 1e-7 and the result in 1e-14.  */
+    EXACT_T e = { 0, 1 };
+    if (op == 0) e.p = (a + b) * SCALE;
+    else if (op == 1) e.p = (a - b) * SCALE;
+    else if (op == 2) e.p = a * b;
+    else if (b != 0) {
+        e.p = a * SCALE * SCALE;
+        e.q = b;
+        if (e.q < 0) {
+            e.p = -e.p;
+            e.q = -e.q;
+        }
+    } else {
+        e.q = 0;
+    }
+    return e;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static bool parseText(const char *pText, BIG_T *pValue)
+{
+    /*  The text in units of 1e-7, e.g. "-0.5" is -5000000.  */
+    bool isNegative = (*pText == '-');
+    if (isNegative) pText++;
+    BIG_T value = 0;
+    int8_t decimals = -1;
+    for (; *pText; pText++) {
+        if (*pText == '.') {
+            if (decimals >= 0) return false;
+            decimals = 0;
+        } else if (*pText >= '0' && *pText <= '9') {
+            value = value * 10 + *pText - '0';
+            if (decimals >= 0 && ++decimals > 7) return false;
+        } else {
+            return false;
+        }
+    }
+    for (int8_t i = (decimals < 0) ? 0 : decimals; i < 7; i++) value *= 10;
+    *pValue = (isNegative) ? -value : value;
+    return true;
+}
+
+static bool isShownInFull(const char *pText)
+{
+    /*  The lower digits may be cut off only when all 8 places are used.  */
+    uint8_t digits = 0;
+    for (; *pText; pText++) digits += (*pText >= '0' && *pText <= '9');
+    return digits < DISPLAY_MAX;
+}
+
+static bool isWellFormed(const char *pText)
+{
+    if (strcmp(pText, "-E-") == 0) return true;
+    if (*pText == '-') pText++;
+    uint8_t digits = 0, dots = 0;
+    for (; *pText; pText++) {
+        if (*pText >= '0' && *pText <= '9') digits++;
+        else if (*pText == '.') dots++;
+        else return false;
+    }
+    return digits >= 1 && digits <= DISPLAY_MAX && dots <= 1;
+}
+
+static int8_t getDepth(void)
+{
+    static char text[TEXT_MAX];
+    int8_t depth = 0;
+    while (depth < LEVEL_MAX && decodeCalc(depth, text) >= 0) depth++;
+    return depth;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static void reportFailure(const char *pFormat, ...)
+{
+    static long count;
+    if (!isVerbose && count > PRINT_MAX) return;
+    if (!isVerbose && count++ == PRINT_MAX) {
+        puts("...");
+        return;
+    }
+    va_list args;
+    va_start(args, pFormat);
+    vprintf(pFormat, args);
+    va_end(args);
+}
+
+#ifndef FUZZING
+
+/*---------------------------------------------------------------------------*/
+
+static bool checkPair(uint8_t op, const char *pA, const char *pB)
+{
+    static char text[TEXT_MAX];
+    BIG_T a, b;
+    parseText(pA, &a);
+    parseText(pB, &b);
+    auto start = std::chrono::steady_clock::now();
+    updateCalc(BTN_ALLCLEAR);
+    typeNumber(pA);
+    updateCalc(BTN_ENTER);
+    typeNumber(pB);
+    updateCalc(BTN_PLUS + op);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    engineTime += elapsed.count();
+    decodeCalc(0, text);
+    if (!checkResult(op, a, b, text, &pairStat[op])) {
+        reportFailure("%s ENTER %s %c = %s\n", pA, pB, opNames[op], text);
+        return false;
+    }
+    return true;
+}
+
+static bool checkZero(const char *pA, const char *pB, const char *pC)
+{
+    static char plain[TEXT_MAX], text[TEXT_MAX];
+    uint8_t key = BTN_PLUS + (zeroCount++ & 1); // + and - in turn
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        updateCalc(BTN_ALLCLEAR);
+        typeNumber(pA);
+        updateCalc(BTN_ENTER);
+        typeNumber(pB);
+        updateCalc(BTN_DIV);
+        if (pass == 1) {
+            updateCalc(BTN_0);
+            updateCalc(key);
+        }
+        typeNumber(pC);
+        updateCalc(BTN_MULTI);
+        decodeCalc(0, (pass == 0) ? plain : text);
+    }
+    if (strcmp(plain, text) == 0) return true;
+    reportFailure("%s ENTER %s / 0 %c %s * = %s, not %s\n", pA, pB, opNames[key - BTN_PLUS], pC, text, plain);
+    zeroFailures++;
+    return false;
+}
+
+static void typeNumber(const char *pText)
+{
+    bool isNegative = (*pText == '-');
+    if (isNegative) pText++;
+    for (; *pText; pText++) updateCalc(getNumberButton(*pText));
+    if (isNegative) updateCalc(BTN_INVERT);
+}
+
+static void makeNumber(char *pText)
+{
+    /*  Up to 8 digits with up to 7 decimals, as they can be typed.  */
+    static const char edgeDigits[] = "0019";
+    uint64_t r = getRandom();
+    bool isEdge = (r & 3) == 0; // nines and zeros carry and cancel the most
+    uint8_t intLen = (r >> 2) % (DISPLAY_MAX + 1);
+    uint8_t fracMax = DISPLAY_MAX - intLen;
+    if (fracMax > DISPLAY_MAX - 1) fracMax = DISPLAY_MAX - 1;
+    uint8_t fracLen = (r >> 8) % (fracMax + 1);
+    if (intLen == 0 && fracLen == 0) fracLen = 1;
+    char *p = pText;
+    if ((r >> 16) & 1) *p++ = '-';
+    if (intLen == 0) *p++ = '0';
+    for (uint8_t i = 0; i < intLen + fracLen; i++) {
+        if (i == intLen) *p++ = '.';
+        uint64_t d = getRandom();
+        char c = (isEdge) ? edgeDigits[d & 3] : '0' + d % 10;
+        if (i == 0 && intLen > 0 && c == '0') c = '1';
+        *p++ = c;
+    }
+    *p = '\0';
+    BIG_T value;
+    parseText(pText, &value);
+    if (value == 0 && pText[0] == '-') memmove(pText, pText + 1, strlen(pText)); // zero cannot be inverted
+}
+
+static uint8_t makeKey(void)
+{
+    /*  Mostly digits and operators, which build up numbers to operate on.  */
+    uint64_t r = getRandom() % 100;
+    if (r < 45) return BTN_0 + getRandom() % 10;
+    if (r < 50) return BTN_DOT;
+    if (r < 55) return BTN_INVERT;
+    if (r < 65) return BTN_ENTER;
+    if (r < 85) return BTN_PLUS + getRandom() % OPS;
+    if (r < 90) return BTN_UNDO;
+    return BTN_CLEAR + getRandom() % (BTN_SHIFT - BTN_CLEAR);
+}
+
+static uint64_t getRandom(void)
+{
+    /*  xorshift64*, the same seed gives the same run.  */
+    seed ^= seed >> 12;
+    seed ^= seed << 25;
+    seed ^= seed >> 27;
+    return seed * 0x2545F4914F6CDD1DULL;
+}
+
+static void printStat(const char *pName, const STAT_T *pStat)
+{
+    printf("%-3s %-9ld", pName, pStat->count);
+    for (uint8_t i = 0; i < HIST_SIZE; i++) printf(" %8ld", pStat->hist[i]);
+    printf(" %7ld %7ld %7ld %9.6f\n", pStat->errors, pStat->above, pStat->range, pStat->maxUlp);
+}
+
+#endif
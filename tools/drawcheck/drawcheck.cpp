@@ -0,0 +1,244 @@
+/*
+  drawcheck - Golden images and timing of the screen drawing of calc.cpp
+
+  Build on a host (from the top of the repository):
+
+    c++ -O2 -D__AVR_ATtiny85__ -I tools/rpneval -o drawcheck \
+        tools/drawcheck/drawcheck.cpp calc.cpp
+
+  Usage:
+
+    drawcheck [options] [script [directory]]
+
+  Each line of the script is a keystroke sequence in the tokens of rpneval,
+  evaluated from all clear. The pages of drawCalc() are captured into a
+  128x32 image, which is compared with NN.pbm in the directory where NN is
+  the line number. The script and the directory default to scripts.txt and
+  golden/ of tools/drawcheck. The exit status is 1 if any image differs.
+
+  Each screen is also drawn repeatedly to time drawCalc() for the whole
+  frame, page 0 which is drawStack(), and the other pages which are
+  drawNumber() over the cached glyphs. The time of clearScreenBuffer() is
+  taken off the pages.
+
+    -u        Write the images instead of comparing them
+    -n n      Frames drawn for each timing (2000)
+    -v        Print the times of each line
+*/
+
+#include <stdio.h>
+#include <unistd.h>
+#include <chrono>
+#include "tokens.h"
+
+/*  Defines  */
+
+#define LINE_MAX    1024
+#define PATH_MAX    1024
+#define PAGES       (HEIGHT / PAGE_HEIGHT)
+
+/*  Typedefs  */
+
+typedef struct {
+    double  frame, stack, number; // in ns
+} TIME_T;
+
+/*  Local Functions  */
+
+static bool     evaluateLine(char *pLine);
+static void     captureScreen(uint8_t image[PAGES][WIDTH]);
+static void     timeScreen(TIME_T *pTime);
+static double   timeCall(void (*func)(int16_t, uint8_t *), int16_t y);
+static void     clearOnly(int16_t y, uint8_t *pBuffer);
+static bool     writeImage(const char *pPath, uint8_t image[PAGES][WIDTH]);
+static bool     readImage(const char *pPath, uint8_t image[PAGES][WIDTH]);
+
+/*  Local Variables  */
+
+static uint8_t  pageBuffer[WIDTH];
+static long     frameCount = 2000;
+
+/*---------------------------------------------------------------------------*/
+
+void clearScreenBuffer(void)
+{
+    memset(pageBuffer, 0, WIDTH);
+}
+
+#ifdef BATTERY_LEVELS
+uint8_t getBatteryLevel(void)
+{
+    return BATTERY_LEVELS;
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    static char line[LINE_MAX], path[PATH_MAX];
+    static uint8_t image[PAGES][WIDTH], golden[PAGES][WIDTH];
+    bool isUpdate = false, isVerbose = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "un:v")) != -1) {
+        if (opt == 'u') isUpdate = true;
+        else if (opt == 'n') frameCount = atol(optarg);
+        else if (opt == 'v') isVerbose = true;
+        else return 2;
+    }
+    const char *pScript = (optind < argc) ? argv[optind] : "tools/drawcheck/scripts.txt";
+    const char *pDir = (optind + 1 < argc) ? argv[optind + 1] : "tools/drawcheck/golden";
+    FILE *fp = fopen(pScript, "r");
+    if (fp == NULL) {
+        perror(pScript);
+        return 2;
+    }
+
+    initCalc();
+    int lineNo = 0, failures = 0;
+    TIME_T total = { 0, 0, 0 }, worst = { 0, 0, 0 };
+    while (fgets(line, sizeof(line), fp)) {
+        lineNo++;
+        snprintf(path, sizeof(path), "%s/%02d.pbm", pDir, lineNo);
+        updateCalc(BTN_ALLCLEAR);
+        if (!evaluateLine(line)) {
+            fprintf(stderr, "%d: unknown token\n", lineNo);
+            failures++;
+            continue;
+        }
+        captureScreen(image);
+        if (isUpdate) {
+            if (!writeImage(path, image)) return 2;
+        } else if (!readImage(path, golden)) {
+            printf("%02d  no golden image\n", lineNo);
+            failures++;
+        } else if (memcmp(image, golden, sizeof(image)) != 0) {
+            int pixels = 0;
+            for (uint16_t i = 0; i < sizeof(image); i++) {
+                pixels += __builtin_popcount(((uint8_t *)image)[i] ^ ((uint8_t *)golden)[i]);
+            }
+            printf("%02d  differs in %d pixels\n", lineNo, pixels);
+            failures++;
+        }
+
+        TIME_T time;
+        timeScreen(&time);
+        if (isVerbose) printf("%02d  %8.0f %8.0f %8.0f ns\n", lineNo, time.frame, time.stack, time.number);
+        total.frame += time.frame;
+        total.stack += time.stack;
+        total.number += time.number;
+        if (time.frame > worst.frame) worst.frame = time.frame;
+        if (time.stack > worst.stack) worst.stack = time.stack;
+        if (time.number > worst.number) worst.number = time.number;
+    }
+    fclose(fp);
+
+    if (lineNo > 0) {
+        printf("            mean     worst\n");
+        printf("drawCalc    %5.0f ns  %5.0f ns per frame\n", total.frame / lineNo, worst.frame);
+        printf("drawStack   %5.0f ns  %5.0f ns\n", total.stack / lineNo, worst.stack);
+        printf("drawNumber  %5.0f ns  %5.0f ns per page\n", total.number / lineNo, worst.number);
+    }
+    printf("%d of %d images %s\n", (isUpdate) ? lineNo : lineNo - failures, lineNo,
+            (isUpdate) ? "written" : "match");
+    return (failures == 0) ? 0 : 1;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static bool evaluateLine(char *pLine)
+{
+    for (char *pToken = strtok(pLine, " \t\r\n"); pToken; pToken = strtok(NULL, " \t\r\n")) {
+        uint8_t button = getTokenButton(pToken);
+        if (button != BTN_NONE) {
+            updateCalc(button);
+            continue;
+        }
+        if (!isNumberToken(pToken)) return false;
+        for (char *p = pToken; *p; p++) {
+            updateCalc(getNumberButton(*p));
+        }
+    }
+    return true;
+}
+
+static void captureScreen(uint8_t image[PAGES][WIDTH])
+{
+    for (uint8_t page = 0; page < PAGES; page++) {
+        drawCalc(page * PAGE_HEIGHT, pageBuffer);
+        memcpy(image[page], pageBuffer, WIDTH);
+    }
+}
+
+static void timeScreen(TIME_T *pTime)
+{
+    double clear = timeCall(clearOnly, 0);
+    pTime->frame = 0;
+    for (uint8_t page = 0; page < PAGES; page++) {
+        pTime->frame += timeCall(drawCalc, page * PAGE_HEIGHT);
+    }
+    pTime->stack = timeCall(drawCalc, 0) - clear;
+    pTime->number = 0;
+    for (uint8_t page = 1; page < PAGES; page++) {
+        pTime->number += timeCall(drawCalc, page * PAGE_HEIGHT) - clear;
+    }
+    if (PAGES > 1) pTime->number /= PAGES - 1;
+}
+
+static double timeCall(void (*func)(int16_t, uint8_t *), int16_t y)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < frameCount; i++) {
+        func(y, pageBuffer);
+        __asm__ __volatile__("" : : "r"(pageBuffer) : "memory"); // keep every call
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / frameCount;
+}
+
+static void clearOnly(int16_t y, uint8_t *pBuffer)
+{
+    (void)y;
+    (void)pBuffer;
+    clearScreenBuffer();
+}
+
+/*---------------------------------------------------------------------------*/
+
+static bool writeImage(const char *pPath, uint8_t image[PAGES][WIDTH])
+{
+    /*  Plain PBM, 1 is a lit pixel, 64 pixels per text line.  */
+    FILE *fp = fopen(pPath, "w");
+    if (fp == NULL) {
+        perror(pPath);
+        return false;
+    }
+    fprintf(fp, "P1\n%d %d\n", WIDTH, HEIGHT);
+    for (uint8_t y = 0; y < HEIGHT; y++) {
+        for (uint8_t x = 0; x < WIDTH; x++) {
+            fputc((image[y / PAGE_HEIGHT][x] >> (y % PAGE_HEIGHT) & 1) ? '1' : '0', fp);
+            if (x % 64 == 63) fputc('\n', fp);
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+static bool readImage(const char *pPath, uint8_t image[PAGES][WIDTH])
+{
+    FILE *fp = fopen(pPath, "r");
+    if (fp == NULL) return false;
+    int w, h;
+    bool isValid = (fscanf(fp, "P1 %d %d", &w, &h) == 2 && w == WIDTH && h == HEIGHT);
+    memset(image, 0, PAGES * WIDTH);
+    for (uint16_t i = 0; isValid && i < WIDTH * HEIGHT; ) {
+        int c = fgetc(fp);
+        if (c == EOF) {
+            isValid = false;
+        } else if (c == '0' || c == '1') {
+            uint8_t y = i / WIDTH, x = i % WIDTH;
+            if (c == '1') image[y / PAGE_HEIGHT][x] |= 1 << (y % PAGE_HEIGHT);
+            i++;
+        }
+    }
+    fclose(fp);
+    return isValid;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+/*  Stand-in for the Arduino core of ATtiny85 with the button ladder driven by the model.  */
+
+#include "../rpneval/Arduino.h"
+#include <avr/io.h>
+
+#define INPUT       0
+#define A3          3
+
+extern uint16_t ladderValue;
+
+static inline void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+static inline int analogRead(uint8_t pin) { (void)pin; return ladderValue; }
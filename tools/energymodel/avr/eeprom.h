@@ -0,0 +1,27 @@
+#pragma once
+
+/*  EEPROM stand-in backed by RAM, which counts the bytes really written.  */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EEMEM
+
+void    writeEeprom(uint8_t *p, uint8_t value);
+
+static inline uint8_t eeprom_read_byte(const uint8_t *p) { return *p; }
+static inline void eeprom_update_byte(uint8_t *p, uint8_t value) { writeEeprom(p, value); }
+static inline uint16_t eeprom_read_word(const uint16_t *p) { return *p; }
+static inline void eeprom_update_word(uint16_t *p, uint16_t value)
+{
+    writeEeprom((uint8_t *)p, value & 0xFF);
+    writeEeprom((uint8_t *)p + 1, value >> 8);
+}
+static inline void eeprom_read_block(void *pDst, const void *pSrc, size_t n)
+{
+    for (size_t i = 0; i < n; i++) ((uint8_t *)pDst)[i] = ((const uint8_t *)pSrc)[i];
+}
+static inline void eeprom_update_block(const void *pSrc, void *pDst, size_t n)
+{
+    for (size_t i = 0; i < n; i++) writeEeprom((uint8_t *)pDst + i, ((const uint8_t *)pSrc)[i]);
+}
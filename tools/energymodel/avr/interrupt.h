@@ -0,0 +1,4 @@
+#pragma once
+
+#define cli()
+#define sei()
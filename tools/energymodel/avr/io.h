@@ -0,0 +1,36 @@
+#pragma once
+
+/*  Registers touched by core.cpp, the I2C pins are watched by the model.  */
+
+#include <stdint.h>
+
+#define _BV(bit)    (1 << (bit))
+#define bit_is_set(reg, bit)    ((reg) & _BV(bit))
+
+#define MUX2        2
+#define MUX3        3
+#define ADSC        6
+#define CLKPCE      7
+
+class BusRegister { // DDR of the open drain I2C pins
+public:
+    BusRegister &operator|=(uint8_t bits) { update(value | bits); return *this; }
+    BusRegister &operator&=(uint8_t bits) { update(value & bits); return *this; }
+    operator uint8_t() const { return value; }
+private:
+    void    update(uint8_t newValue);
+    uint8_t value;
+};
+
+class AdcRegister { // a conversion is done as soon as it is started
+public:
+    AdcRegister &operator|=(uint8_t bits) { value |= bits; return *this; }
+    operator uint8_t() { uint8_t v = value; value &= ~_BV(ADSC); return v; }
+private:
+    uint8_t value;
+};
+
+extern BusRegister  DDRB;
+extern AdcRegister  ADCSRA;
+extern uint8_t      PORTB, PINB, ADMUX, CLKPR;
+extern uint16_t     ADC;
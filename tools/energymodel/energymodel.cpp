@@ -0,0 +1,323 @@
+/*
+  energymodel - Charge estimate of a keystroke trace on ATtiny85
+
+  Build on a host (from the top of the repository):
+
+    c++ -O2 -D__AVR_ATtiny85__ -DF_CPU=4000000UL -DDISABLEMILLIS \
+        -include tools/wcet/counted.h -I tools/energymodel -I tools/rpneval \
+        -o energymodel tools/energymodel/energymodel.cpp tools/oledemu/ssd1306.cpp \
+        core.cpp calc.cpp -x c++ ATtiny85RpnCalc.ino
+
+  Usage:
+
+    energymodel [options] [file...]
+
+  The trace is a list of keys in the tokens of rpneval, e.g. "1 ENTER 3 /".
+  "@2.5" waits 2.5 seconds before the next key instead of the usual gap.
+  The second functions, such as SWAP, are pressed after the shift button.
+
+  The sketch itself runs in a loop with the buttons driven through the
+  ladder, so the shift layer, the dimming, the sleep and the power saving of
+  core.cpp act as on the device. The I2C lines drive the model of SSD1306
+  in tools/oledemu, which counts the bytes and the clocks and follows the
+  state, the contrast and the lit pixels. Busy waits advance the time of
+  the model.
+
+  calc.cpp is built on the counted mantissa of tools/wcet, so the cycles of
+  each handler follow its own arithmetic and operands. A key costs its
+  counted cycles before the frame of its loop, plus a fixed part for the
+  scan, the dispatch and the bookkeeping. A frame costs the counted cycles
+  of decoding its numbers, plus a fixed part for drawing the pages. The
+  cycles of each handler are listed after the totals.
+
+    -v mV     Supply voltage (3000)
+    -g sec    Gap between keys (1.0)
+    -m mA     Active current of ATtiny85 at 4 MHz (1.5)
+    -o mA     Current of SSD1306 while it is on, no pixels lit (0.5)
+    -p uA     Current per lit pixel at full contrast (3.0)
+    -s uA     Current of SSD1306 while it is off (5.0)
+    -c n      CPU cycles per I2C clock (24)
+    -k n      CPU cycles of a key besides its arithmetic (2000)
+    -f n      CPU cycles of a frame besides its arithmetic (20000)
+    -b mAh    Capacity of the cell (225)
+*/
+
+#include <stdio.h>
+#include <unistd.h>
+#include "../oledemu/ssd1306.h"
+#include "tokens.h"
+
+void    setup(void); // in ATtiny85RpnCalc.ino
+void    loop(void);
+
+/*  Defines  */
+
+#define LINE_MAX        1024
+#define OSC_FREQ        8000000UL // divided by CLKPR
+#define BANDGAP_MV      1100
+#define ADC_MAX         1023
+#define EEPROM_WRITE_US 3400
+#define PRESS_LOOPS     2
+#define SHIFT_GAP       0.3 // seconds from the shift button to the next
+
+/*  Local Functions  */
+
+static bool     replayLine(char *pLine);
+static bool     pressButton(uint8_t button);
+static bool     pressKey(uint8_t button, long &handlerCycles);
+static void     waitIdle(double us);
+static long     runLoop(void);
+static uint16_t getLadderValue(uint8_t button);
+static void     printHandlers(void);
+static void     countClock(void);
+static void     countFrame(void);
+static void     advanceTime(double us);
+static double   getClockFreq(void);
+
+/*  Global Variables  */
+
+BusRegister     DDRB;
+AdcRegister     ADCSRA;
+uint8_t         PORTB, PINB, ADMUX, CLKPR;
+uint16_t        ADC;
+uint16_t        ladderValue;
+OP_COUNT_T      opCount;
+
+/*  Local Variables  */
+
+static struct {
+    double  vcc, gap, mcuMa, oledMa, pixelUa, sleepUa, cell;
+    long    cyclesPerClock, cyclesPerKey, cyclesPerFrame;
+} model = { 3000, 1.0, 1.5, 0.5, 3.0, 5.0, 225, 24, 2000, 20000 };
+
+static struct {
+    long    presses, cycles;
+} handlerStats[BTN_SHIFT + 1];
+
+static double   nextGap, timeUs, mcuCharge, oledCharge; // in uC
+static long     keys, eepromBytes, keyCycles, frameCycles;
+static long     frameMark; // count of the arithmetic at the first clock of the loop
+static uint16_t litPixels;
+
+/*---------------------------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+    static char line[LINE_MAX];
+    int opt;
+    while ((opt = getopt(argc, argv, "v:g:m:o:p:s:c:k:f:b:")) != -1) {
+        double value = (optarg) ? atof(optarg) : 0;
+        if (opt == 'v') model.vcc = value;
+        else if (opt == 'g') model.gap = value;
+        else if (opt == 'm') model.mcuMa = value;
+        else if (opt == 'o') model.oledMa = value;
+        else if (opt == 'p') model.pixelUa = value;
+        else if (opt == 's') model.sleepUa = value;
+        else if (opt == 'c') model.cyclesPerClock = value;
+        else if (opt == 'k') model.cyclesPerKey = value;
+        else if (opt == 'f') model.cyclesPerFrame = value;
+        else if (opt == 'b') model.cell = value;
+        else return 2;
+    }
+
+    CLKPR = 1; // 4 MHz from the internal oscillator, as the boot code sets
+    ADC = BANDGAP_MV * ADC_MAX / model.vcc; // of a chip at the nominal bandgap
+    ladderValue = getLadderValue(BTN_NONE);
+    resetOled();
+    onBusClock = countClock;
+    onOledFrame = countFrame;
+    setup();
+    timeUs = mcuCharge = oledCharge = 0; // from the first frame
+    memset(&busCount, 0, sizeof(busCount));
+    eepromBytes = keyCycles = frameCycles = 0;
+
+    bool isValid = true;
+    nextGap = model.gap;
+    for (int i = optind; i < argc || i == optind; i++) {
+        FILE *fp = (i < argc) ? fopen(argv[i], "r") : stdin;
+        if (fp == NULL) {
+            perror(argv[i]);
+            return 2;
+        }
+        while (fgets(line, sizeof(line), fp)) {
+            if (!replayLine(line)) isValid = false;
+        }
+        if (fp != stdin) fclose(fp);
+    }
+    waitIdle(nextGap * 1000000); // until the screen would be saved
+
+    double seconds = timeUs / 1000000, charge = mcuCharge + oledCharge;
+    double averageMa = (timeUs > 0) ? charge / timeUs * 1000 : 0;
+    printf("keys        %ld\n", keys);
+    printf("frames      %ld\n", busCount.frames);
+    printf("I2C         %ld bytes, %ld clocks\n", busCount.bytes, busCount.clocks);
+    printf("EEPROM      %ld bytes\n", eepromBytes);
+    printf("cycles      %ld (keys %ld, frames %ld)\n", keyCycles + frameCycles, keyCycles, frameCycles);
+    printf("time        %.1f s\n", seconds);
+    printf("charge      %.1f mC (MCU %.1f mC, OLED %.1f mC)\n",
+            charge / 1000, mcuCharge / 1000, oledCharge / 1000);
+    if (keys > 0) printf("per key     %.3f mC\n", charge / 1000 / keys);
+    printf("per hour    %.3f mAh of use\n", averageMa);
+    if (averageMa > 0) printf("cell        %.0f hours of use\n", model.cell / averageMa);
+    printHandlers();
+    return isValid ? 0 : 1;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void writeEeprom(uint8_t *p, uint8_t value)
+{
+    if (*p == value) return;
+    *p = value;
+    eepromBytes++;
+    advanceTime(EEPROM_WRITE_US);
+}
+
+void _delay_ms(double ms)
+{
+    advanceTime(ms * 1000 * F_CPU / getClockFreq());
+}
+
+void _delay_us(double us)
+{
+    advanceTime(us * F_CPU / getClockFreq());
+}
+
+void _delay_loop_1(uint8_t count)
+{
+    advanceTime((count ? count : 256) * 3 / getClockFreq() * 1000000);
+}
+
+/*---------------------------------------------------------------------------*/
+
+static bool replayLine(char *pLine)
+{
+    bool isValid = true;
+    for (char *pToken = strtok(pLine, " \t\r\n"); pToken; pToken = strtok(NULL, " \t\r\n")) {
+        if (*pToken == '@') {
+            nextGap = atof(pToken + 1);
+            continue;
+        }
+        uint8_t button = getTokenButton(pToken);
+        if (button != BTN_NONE) {
+            if (!pressButton(button)) isValid = false;
+        } else if (isNumberToken(pToken)) {
+            for (char *p = pToken; *p; p++) pressButton(getNumberButton(*p));
+        } else {
+            fprintf(stderr, "unknown token: %s\n", pToken);
+            isValid = false;
+        }
+    }
+    return isValid;
+}
+
+static bool pressButton(uint8_t button)
+{
+    /*  A second function is reached by the shift button just before its button.  */
+    long cycles = 0;
+    uint8_t key = button;
+    for (uint8_t i = BTN_0; i <= BTN_SHIFT; i++) {
+        if (getSecondButton(i) == button) {
+            pressKey(BTN_SHIFT, cycles);
+            nextGap = SHIFT_GAP;
+            key = i;
+            break;
+        }
+    }
+    if (!pressKey(key, cycles)) return false;
+    handlerStats[button].presses++;
+    handlerStats[button].cycles += cycles;
+    return true;
+}
+
+static bool pressKey(uint8_t button, long &handlerCycles)
+{
+    uint16_t value = getLadderValue(button);
+    if (decodeButton(value) != button) {
+        fprintf(stderr, "no key for button %d\n", button);
+        return false;
+    }
+
+    waitIdle(nextGap * 1000000);
+    nextGap = model.gap;
+    keys++;
+    keyCycles += model.cyclesPerKey;
+    handlerCycles += model.cyclesPerKey;
+    advanceTime(model.cyclesPerKey / getClockFreq() * 1000000);
+    ladderValue = value;
+    for (uint8_t i = 0; i < PRESS_LOOPS; i++) handlerCycles += runLoop();
+    ladderValue = getLadderValue(BTN_NONE);
+    return true;
+}
+
+static void waitIdle(double us)
+{
+    for (double end = timeUs + us; timeUs < end; ) runLoop();
+}
+
+static long runLoop(void)
+{
+    /*  The arithmetic before the first clock of the frame is of the handler.  */
+    long start = opCount.cycles;
+    frameMark = -1;
+    loop();
+    long end = opCount.cycles, mark = (frameMark < 0) ? end : frameMark;
+    keyCycles += mark - start;
+    frameCycles += end - mark;
+    advanceTime((end - start) / getClockFreq() * 1000000);
+    return mark - start;
+}
+
+static uint16_t getLadderValue(uint8_t button)
+{
+    /*  The middle of the range of the button.  */
+    int16_t lower = -1, upper = -1;
+    for (int16_t value = 0; value <= ADC_MAX; value++) {
+        if (decodeButton(value) != button) continue;
+        if (lower < 0) lower = value;
+        upper = value;
+    }
+    return (lower < 0) ? ADC_MAX : (lower + upper + 1) / 2;
+}
+
+static void printHandlers(void)
+{
+    printf("\nhandler     presses  cycles per press\n");
+    for (uint8_t button = BTN_0; button <= BTN_SHIFT; button++) {
+        if (handlerStats[button].presses == 0) continue;
+        char name[8];
+        snprintf(name, sizeof(name), "%c", (button == BTN_DOT) ? '.' : '0' + button - BTN_0);
+        for (uint8_t i = 0; i < sizeof(tokenTable) / sizeof(tokenTable[0]); i++) {
+            if (tokenTable[i].button == button) snprintf(name, sizeof(name), "%s", tokenTable[i].pName);
+        }
+        printf("%-10s %8ld %10.0f\n", name, handlerStats[button].presses,
+                (double)handlerStats[button].cycles / handlerStats[button].presses);
+    }
+}
+
+static void countClock(void)
+{
+    if (frameMark < 0) frameMark = opCount.cycles;
+    advanceTime(model.cyclesPerClock / getClockFreq() * 1000000);
+}
+
+static void countFrame(void)
+{
+    litPixels = countLitPixels();
+    frameCycles += model.cyclesPerFrame;
+    advanceTime(model.cyclesPerFrame / getClockFreq() * 1000000);
+}
+
+static void advanceTime(double us)
+{
+    double oledUa = model.sleepUa;
+    if (oled.isOn) oledUa = model.oledMa * 1000 + model.pixelUa * litPixels * oled.contrast / 255;
+    mcuCharge += model.mcuMa * getClockFreq() / 4000000 * us / 1000;
+    oledCharge += oledUa * us / 1000000;
+    timeUs += us;
+}
+
+static double getClockFreq(void)
+{
+    return OSC_FREQ >> (CLKPR & 0x0F);
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+/*  Busy waits advance the time of the model instead.  */
+
+void    _delay_ms(double ms);
+void    _delay_us(double us);
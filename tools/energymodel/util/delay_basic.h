@@ -0,0 +1,5 @@
+#pragma once
+
+#include <stdint.h>
+
+void    _delay_loop_1(uint8_t count);
@@ -0,0 +1,343 @@
+/*
+  laddersim - Accuracy and latency of the button ladder decoding on ATtiny85
+
+  Build on a host (from the top of the repository):
+
+    c++ -O2 -D__AVR_ATtiny85__ -DF_CPU=4000000UL -DDISABLEMILLIS \
+        -I tools/energymodel -I tools/rpneval -o laddersim \
+        tools/laddersim/laddersim.cpp core.cpp
+
+  Usage:
+
+    laddersim [options]
+
+  Random key presses are played on simulated units of the resistor ladder
+  in the schematic, each with its own resistor values and ADC errors.
+  The switches bounce when they are pressed and released, with a contact
+  resistance between open and closed. Each reading also has ADC noise and
+  the droop of VCC between sampling and conversion.
+
+  The readings are decoded by decodeButton() of core.cpp with several
+  sampling periods and filters. A press counts as detected when exactly
+  its button is reported once before the next press, and its latency is
+  measured from the first touch.
+
+  The margin of a button is the distance from its reading without noise
+  to the nearest threshold of decodeButton(). It is reported for the
+  nominal ladder and for the worst of the units, and the exit status is 1
+  if the worst margin is below the limit.
+
+    -n n      Presses for each strategy (20000)
+    -u n      Units, the presses are shared among them (20)
+    -r %      Tolerance of resistors (5)
+    -a LSB    Standard deviation of ADC noise (1.0)
+    -e LSB    Offset and gain error of ADC (2.0)
+    -d %      Standard deviation of VCC droop while converting (0.3)
+    -b ms     Longest bounce of a switch (5)
+    -m LSB    Smallest margin of a threshold to pass (4.0)
+    -s n      Seed (1)
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include "../../common.h"
+
+/*  Defines  */
+
+#define PULL_UP_OHM     4700
+#define CONTACT_MIN     10.0    // ohm, while bouncing
+#define CONTACT_MAX     1000000.0
+#define SAMPLE_SPACING  0.2     // ms between readings of one loop
+#define GAP_MIN         80      // ms between presses
+#define GAP_MAX         400
+#define PRESS_MIN       50      // ms of a press
+#define PRESS_MAX       200
+#define NODE_OPEN       -1      // no button is pressed
+#define ADC_MAX         1023
+
+/*  Typedefs  */
+
+typedef struct {
+    double  start, end, bounceIn, bounceOut; // in ms
+    uint8_t node;
+} PRESS_T;
+
+typedef struct {
+    double  pullUp, series[20], offset, gain;
+} UNIT_T;
+
+/*  Local Functions  */
+
+static void     makeUnit(UNIT_T *pUnit);
+static double   getWorstMargin(const UNIT_T *pUnit, int8_t &worstNode);
+static double   getMargin(double value, uint8_t button);
+static double   getIdealValue(const UNIT_T *pUnit, int8_t node);
+static void     runStrategy(uint8_t strategy, uint8_t period);
+static uint16_t readLadder(const UNIT_T *pUnit, double t, size_t &idx);
+static double   getContact(double t, size_t idx);
+static double   getUniform(void);
+static double   getGaussian(void);
+
+/*  Global Variables  */
+
+BusRegister     DDRB;
+AdcRegister     ADCSRA;
+uint8_t         PORTB, PINB, ADMUX, CLKPR;
+uint16_t        ADC;
+uint16_t        ladderValue;
+
+/*  Local Variables  */
+
+static const struct {
+    uint32_t    ohm;    // from the previous node
+    uint8_t     button; // shorts the node to the ground
+} ladderTable[] = {
+    { 0,     BTN_SHIFT }, { 150,   BTN_CLEAR }, { 180,   BTN_DIV   }, { 220,   BTN_9     },
+    { 330,   BTN_8     }, { 390,   BTN_7     }, { 510,   BTN_4     }, { 680,   BTN_5     },
+    { 1000,  BTN_6     }, { 1500,  BTN_MULTI }, { 1500,  BTN_MINUS }, { 2200,  BTN_3     },
+    { 3000,  BTN_2     }, { 4700,  BTN_1     }, { 8200,  BTN_0     }, { 15000, BTN_DOT   },
+    { 22000, BTN_ENTER }, { 82000, BTN_PLUS  },
+};
+
+static const struct {
+    const char  *pName;
+    uint8_t     samples;    // median of them in each loop
+    uint8_t     confirms;   // loops which have to agree
+} strategyTable[] = {
+    { "single",           1, 1 }, // as getDownButton()
+    { "median3",          3, 1 },
+    { "confirm2",         1, 2 },
+    { "median3+confirm2", 3, 2 },
+};
+
+static const uint8_t periodTable[] = { 100, 50, 20, 10, 5 }; // ms
+
+static struct {
+    long    presses, units;
+    double  tolerance, noise, error, droop, bounce, margin;
+} model = { 20000, 20, 5, 1.0, 2.0, 0.3, 5, 4.0 };
+
+static std::vector<PRESS_T> presses;
+static std::vector<UNIT_T>  units;
+static uint64_t randomState = 1;
+
+/*---------------------------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "n:u:r:a:e:d:b:m:s:")) != -1) {
+        double value = (optarg) ? atof(optarg) : 0;
+        if (opt == 'n') model.presses = value;
+        else if (opt == 'u') model.units = value;
+        else if (opt == 'r') model.tolerance = value;
+        else if (opt == 'a') model.noise = value;
+        else if (opt == 'e') model.error = value;
+        else if (opt == 'd') model.droop = value;
+        else if (opt == 'b') model.bounce = value;
+        else if (opt == 'm') model.margin = value;
+        else if (opt == 's') randomState = strtoull(optarg, NULL, 0);
+        else return 2;
+    }
+    if (model.presses < 1 || model.units < 1) return 2;
+    if (randomState == 0) randomState = 1; // xorshift stays at 0
+
+    UNIT_T nominal = { PULL_UP_OHM, {}, 0, 1 };
+    for (uint8_t i = 0; i < sizeof(ladderTable) / sizeof(ladderTable[0]); i++) {
+        nominal.series[i] = (i > 0) ? nominal.series[i - 1] + ladderTable[i].ohm : ladderTable[i].ohm;
+    }
+    int8_t node, worstNode = NODE_OPEN;
+    double nominalMargin = getWorstMargin(&nominal, node), worstMargin = 1e9;
+    units.resize(model.units);
+    for (UNIT_T &unit : units) {
+        makeUnit(&unit);
+        double margin = getWorstMargin(&unit, node);
+        if (margin < worstMargin) {
+            worstMargin = margin;
+            worstNode = node;
+        }
+    }
+    printf("margin  %.1f LSB nominal, %.1f LSB in the worst unit ", nominalMargin, worstMargin);
+    (worstNode == NODE_OPEN) ? printf("when open") : printf("at node %d", worstNode);
+    printf(", limit %.1f LSB\n\n", model.margin);
+
+    double t = GAP_MAX;
+    for (long i = 0; i < model.presses; i++) {
+        PRESS_T press;
+        press.node = getUniform() * (sizeof(ladderTable) / sizeof(ladderTable[0]));
+        press.start = t;
+        press.end = t + PRESS_MIN + getUniform() * (PRESS_MAX - PRESS_MIN);
+        press.bounceIn = getUniform() * model.bounce;
+        press.bounceOut = getUniform() * model.bounce;
+        presses.push_back(press);
+        t = press.end + press.bounceOut + GAP_MIN + getUniform() * (GAP_MAX - GAP_MIN);
+    }
+
+    printf("period  strategy          errors   latency  p95\n");
+    for (uint8_t p = 0; p < sizeof(periodTable); p++) {
+        for (uint8_t s = 0; s < sizeof(strategyTable) / sizeof(strategyTable[0]); s++) {
+            runStrategy(s, periodTable[p]);
+        }
+    }
+    return (worstMargin >= model.margin) ? 0 : 1;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static void makeUnit(UNIT_T *pUnit)
+{
+    pUnit->pullUp = PULL_UP_OHM * (1 + (getUniform() * 2 - 1) * model.tolerance / 100);
+    for (uint8_t i = 0; i < sizeof(ladderTable) / sizeof(ladderTable[0]); i++) {
+        double ohm = ladderTable[i].ohm * (1 + (getUniform() * 2 - 1) * model.tolerance / 100);
+        pUnit->series[i] = (i > 0) ? pUnit->series[i - 1] + ohm : ohm;
+    }
+    pUnit->offset = (getUniform() * 2 - 1) * model.error;
+    pUnit->gain = 1 + (getUniform() * 2 - 1) * model.error / 1024;
+}
+
+static double getWorstMargin(const UNIT_T *pUnit, int8_t &worstNode)
+{
+    double worst = getMargin(getIdealValue(pUnit, NODE_OPEN), BTN_NONE);
+    worstNode = NODE_OPEN;
+    for (uint8_t i = 0; i < sizeof(ladderTable) / sizeof(ladderTable[0]); i++) {
+        double margin = getMargin(getIdealValue(pUnit, i), ladderTable[i].button);
+        if (margin < worst) {
+            worst = margin;
+            worstNode = i;
+        }
+    }
+    return worst;
+}
+
+static double getMargin(double value, uint8_t button)
+{
+    /*  The ends of the ADC range are no thresholds.  */
+    uint16_t reading = value;
+    if (decodeButton(reading) != button) return 0;
+    double margin = 1e9;
+    for (int16_t v = reading; v >= 0; v--) {
+        if (decodeButton(v) != button) {
+            margin = value - (v + 1);
+            break;
+        }
+    }
+    for (int16_t v = reading; v <= ADC_MAX; v++) {
+        if (decodeButton(v) != button) {
+            margin = std::min(margin, v - value);
+            break;
+        }
+    }
+    return margin;
+}
+
+static double getIdealValue(const UNIT_T *pUnit, int8_t node)
+{
+    double ratio = 1;
+    if (node != NODE_OPEN) ratio = pUnit->series[node] / (pUnit->pullUp + pUnit->series[node]);
+    double value = ratio * 1024 * pUnit->gain + pUnit->offset;
+    return (value < 0) ? 0 : (value > ADC_MAX) ? ADC_MAX : value;
+}
+
+static void runStrategy(uint8_t strategy, uint8_t period)
+{
+    uint8_t samples = strategyTable[strategy].samples;
+    uint8_t confirms = strategyTable[strategy].confirms;
+    std::vector<double> latencies;
+    long errors = 0;
+    size_t idx = 0;
+    uint8_t stableButton = BTN_NONE, lastButton = BTN_NONE, agreed = 0;
+    double t = getUniform() * period; // phase of the loop
+    for (size_t i = 0; i < presses.size(); i++) {
+        /*  Loops until the next press, the unit is changed every so often.  */
+        const UNIT_T *pUnit = &units[i * units.size() / presses.size()];
+        double end = (i + 1 < presses.size()) ? presses[i + 1].start : presses[i].end + GAP_MAX;
+        uint8_t found = 0, foundButton = BTN_NONE;
+        double foundTime = 0;
+        for (; t < end; t += period) {
+            uint16_t values[3];
+            for (uint8_t j = 0; j < samples; j++) values[j] = readLadder(pUnit, t + j * SAMPLE_SPACING, idx);
+            std::sort(values, values + samples);
+            uint8_t currentButton = decodeButton(values[samples / 2]);
+            agreed = (currentButton == lastButton) ? agreed + 1 : 1;
+            lastButton = currentButton;
+            if (agreed >= confirms && lastButton != stableButton) {
+                if (stableButton == BTN_NONE) {
+                    found++;
+                    foundButton = lastButton;
+                    foundTime = t + (samples - 1) * SAMPLE_SPACING;
+                }
+                stableButton = lastButton;
+            }
+        }
+        if (found == 1 && foundButton == ladderTable[presses[i].node].button) {
+            latencies.push_back(foundTime - presses[i].start);
+        } else {
+            errors++;
+        }
+    }
+
+    double mean = 0;
+    for (double latency : latencies) mean += latency;
+    if (!latencies.empty()) mean /= latencies.size();
+    std::sort(latencies.begin(), latencies.end());
+    double p95 = latencies.empty() ? 0 : latencies[latencies.size() * 95 / 100];
+    printf("%3d ms  %-16s %6.2f%% %6.1f ms %4.0f ms\n", period, strategyTable[strategy].pName,
+            100.0 * errors / presses.size(), mean, p95);
+}
+
+static uint16_t readLadder(const UNIT_T *pUnit, double t, size_t &idx)
+{
+    while (idx + 1 < presses.size() && presses[idx + 1].start <= t) idx++;
+    double ratio = 1;
+    double contact = getContact(t, idx);
+    if (contact < CONTACT_MAX) {
+        double below = pUnit->series[presses[idx].node] + contact;
+        ratio = below / (pUnit->pullUp + below);
+    }
+    ratio *= 1 + getGaussian() * model.droop / 100; // VCC moved after sampling
+    double value = ratio * 1024 * pUnit->gain + pUnit->offset + getGaussian() * model.noise;
+    return (value < 0) ? 0 : (value > ADC_MAX) ? ADC_MAX : (uint16_t)value;
+}
+
+static double getContact(double t, size_t idx)
+{
+    /*  A bouncing switch is open or touches with a random resistance.  */
+    const PRESS_T *pPress = &presses[idx];
+    if (t < pPress->start || t >= pPress->end + pPress->bounceOut) return CONTACT_MAX;
+    if (t < pPress->start + pPress->bounceIn || t >= pPress->end) {
+        if (getUniform() < 0.5) return CONTACT_MAX;
+        return CONTACT_MIN * pow(CONTACT_MAX / CONTACT_MIN, getUniform());
+    }
+    return 0;
+}
+
+static double getUniform(void)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return (randomState >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double getGaussian(void)
+{
+    double u = getUniform();
+    return sqrt(-2 * log(u + 1e-300)) * cos(2 * M_PI * getUniform());
+}
+
+/*---------------------------------------------------------------------------*/
+
+void BusRegister::update(uint8_t newValue)
+{
+    value = newValue; // the screen is not simulated
+}
+
+void _delay_ms(double ms)
+{
+    (void)ms;
+}
+
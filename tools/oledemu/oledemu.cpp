@@ -0,0 +1,175 @@
+/*
+  oledemu - I2C bus cost and pixels of the screen refresh on ATtiny85
+
+  Build on a host (from the top of the repository):
+
+    c++ -O2 -D__AVR_ATtiny85__ -DF_CPU=4000000UL -DDISABLEMILLIS \
+        -I tools/energymodel -I tools/rpneval -o oledemu \
+        tools/oledemu/oledemu.cpp tools/oledemu/ssd1306.cpp core.cpp calc.cpp \
+        -x c++ ATtiny85RpnCalc.ino
+
+  Usage:
+
+    oledemu [options] [file...]
+
+  SimpleWire.h is compiled against the register stand-ins of energymodel,
+  so the SDA and SCL transitions drive the model of SSD1306 in ssd1306.cpp.
+  The sketch boots with setup(), then each line of keys in the tokens of
+  rpneval is evaluated from all clear and the screen is refreshed whenever
+  updateCalc() asks for it, as loop() does.
+
+  The bytes, SCL clocks and transactions are reported for the boot and per
+  frame, with the time at the given cycles per clock. After each refresh,
+  the GRAM is compared with the pages drawn by drawCalc(). The exit status
+  is 1 if any frame differs, a byte is not acknowledged or the screen is
+  not on.
+
+    -v        Print the counts of each frame
+    -c n      CPU cycles per SCL clock (24)
+*/
+
+#include <stdio.h>
+#include <unistd.h>
+#include "ssd1306.h"
+#include "tokens.h"
+
+void    setup(void); // in ATtiny85RpnCalc.ino
+
+/*  Defines  */
+
+#define LINE_MAX    1024
+
+/*  Local Functions  */
+
+static bool     evaluateLine(char *pLine);
+static void     refreshFrame(void);
+static bool     checkFrame(void);
+static void     printCount(const char *pName, const BUS_COUNT_T *pCount, long frames);
+
+/*  Global Variables  */
+
+BusRegister     DDRB;
+AdcRegister     ADCSRA;
+uint8_t         PORTB, PINB, ADMUX, CLKPR;
+uint16_t        ADC;
+uint16_t        ladderValue;
+
+/*  Local Variables  */
+
+static bool     isVerbose;
+static long     cyclesPerClock = 24, badFrames;
+
+/*---------------------------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+    static char line[LINE_MAX];
+    int opt;
+    while ((opt = getopt(argc, argv, "vc:")) != -1) {
+        if (opt == 'v') isVerbose = true;
+        else if (opt == 'c') cyclesPerClock = atol(optarg);
+        else return 2;
+    }
+
+    resetOled();
+    setup();
+    BUS_COUNT_T boot = busCount;
+    if (!checkFrame()) badFrames++;
+    printCount("boot", &boot, 1);
+    memset(&busCount, 0, sizeof(busCount));
+
+    bool isValid = true;
+    for (int i = optind; i < argc || i == optind; i++) {
+        FILE *fp = (i < argc) ? fopen(argv[i], "r") : stdin;
+        if (fp == NULL) {
+            perror(argv[i]);
+            return 2;
+        }
+        while (fgets(line, sizeof(line), fp)) {
+            if (updateCalc(BTN_ALLCLEAR)) refreshFrame();
+            if (!evaluateLine(line)) isValid = false;
+        }
+        if (fp != stdin) fclose(fp);
+    }
+    printCount("per frame", &busCount, busCount.frames);
+    printf("bad frames  %ld\n", badFrames);
+    if (!oled.isOn || !oled.isPumped) puts("screen is off");
+    bool isGood = (badFrames == 0 && boot.naks == 0 && busCount.naks == 0 && oled.isOn && oled.isPumped);
+    return (isGood && isValid) ? 0 : 1;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void writeEeprom(uint8_t *p, uint8_t value)
+{
+    *p = value;
+}
+
+void _delay_ms(double ms)
+{
+    (void)ms;
+}
+
+void _delay_us(double us)
+{
+    (void)us;
+}
+
+void _delay_loop_1(uint8_t count)
+{
+    (void)count;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static bool evaluateLine(char *pLine)
+{
+    for (char *pToken = strtok(pLine, " \t\r\n"); pToken; pToken = strtok(NULL, " \t\r\n")) {
+        uint8_t button = getTokenButton(pToken);
+        if (button != BTN_NONE) {
+            if (updateCalc(button)) refreshFrame();
+        } else if (isNumberToken(pToken)) {
+            for (char *p = pToken; *p; p++) {
+                if (updateCalc(getNumberButton(*p))) refreshFrame();
+            }
+        } else {
+            fprintf(stderr, "unknown token: %s\n", pToken);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void refreshFrame(void)
+{
+    BUS_COUNT_T last = busCount;
+    refreshScreen(drawCalc);
+    bool isGood = checkFrame();
+    if (!isGood) badFrames++;
+    if (isVerbose) {
+        printf("frame %-5ld %ld bytes, %ld clocks, %ld transactions%s\n", busCount.frames,
+                busCount.bytes - last.bytes, busCount.clocks - last.clocks,
+                busCount.transactions - last.transactions, (isGood) ? "" : ", differs");
+    }
+}
+
+static bool checkFrame(void)
+{
+    /*  The window of GRAM has to hold exactly what drawCalc() draws.  */
+    static uint8_t page[WIDTH];
+    for (int16_t y = 0; y < HEIGHT; y += PAGE_HEIGHT) {
+        memset(page, 0, sizeof(page));
+        drawCalc(y, page);
+        if (memcmp(oled.gram[y / PAGE_HEIGHT], page, WIDTH) != 0) return false;
+    }
+    return true;
+}
+
+static void printCount(const char *pName, const BUS_COUNT_T *pCount, long frames)
+{
+    if (frames == 0) frames = 1;
+    double us = (double)pCount->clocks / frames * cyclesPerClock / (F_CPU / 1000000);
+    printf("%-11s %.1f bytes, %.1f clocks, %.2f transactions, %.2f ms\n", pName,
+            (double)pCount->bytes / frames, (double)pCount->clocks / frames,
+            (double)pCount->transactions / frames, us / 1000);
+}
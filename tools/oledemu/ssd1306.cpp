@@ -0,0 +1,207 @@
+/*
+  ssd1306 - Model of SSD1306 for the host tools
+
+  The levels of SDA and SCL follow the DDR bits which SimpleWire sets to
+  pull the lines low. They are decoded into START, STOP, address, control,
+  command and data events. The commands used by core.cpp and the reset
+  values are modeled, and the data bytes are stored in GRAM with the
+  horizontal, vertical and page addressing modes. Only the address of
+  SSD1306 is acknowledged, so a wrong address reads NACK on PINB.
+*/
+
+#include "ssd1306.h"
+
+/*  Defines  */
+
+#define SCL_BIT         2 // PB2 and PB0 as wired by core.cpp
+#define SDA_BIT         0
+#define CONTROL_CO      0x80
+#define CONTROL_DATA    0x40
+#define ARGS_MAX        6
+
+/*  Local Functions  */
+
+static void     receiveByte(uint8_t b);
+static void     receiveCommand(uint8_t b);
+static void     executeCommand(void);
+static void     receiveData(uint8_t b);
+static uint8_t  getArgCount(uint8_t command);
+
+/*  Global Variables  */
+
+OLED_T          oled;
+BUS_COUNT_T     busCount;
+void            (*onBusClock)(void);
+void            (*onOledFrame)(void);
+
+/*  Local Variables  */
+
+static struct {
+    bool    isScl, isSda, isActive, isAddress, isAddressed, isControl, isData, isSingle;
+    uint8_t bits, value;
+    uint8_t command, args[ARGS_MAX], argCount, argIndex;
+} bus;
+
+/*---------------------------------------------------------------------------*/
+
+void resetOled(void)
+{
+    memset(&oled, 0, sizeof(oled));
+    oled.contrast = 0x7F;
+    oled.mode = 0x02; // page addressing
+    oled.mux = 63;
+    oled.columnEnd = WIDTH - 1;
+    oled.pageEnd = OLED_PAGES - 1;
+    memset(&bus, 0, sizeof(bus));
+    bus.isScl = bus.isSda = true;
+}
+
+uint16_t countLitPixels(void)
+{
+    uint16_t count = 0;
+    for (uint8_t page = 0; page <= oled.mux / PAGE_HEIGHT && page < OLED_PAGES; page++) {
+        for (uint8_t x = 0; x < WIDTH; x++) count += __builtin_popcount(oled.gram[page][x]);
+    }
+    return count;
+}
+
+void BusRegister::update(uint8_t newValue)
+{
+    /*  Lines are pulled low while their DDR bits are set.  */
+    value = newValue;
+    bool isScl = !(value & _BV(SCL_BIT));
+    bool isSda = !(value & _BV(SDA_BIT));
+    if (bus.isScl && isScl && bus.isSda != isSda) {
+        if (!isSda) { // start condition, or repeated start
+            bus.isActive = true;
+            bus.isAddress = true;
+            bus.bits = 0;
+        } else if (bus.isActive) { // stop condition
+            bus.isActive = false;
+            busCount.transactions++;
+        }
+    } else if (!bus.isScl && isScl) {
+        busCount.clocks++;
+        if (onBusClock) onBusClock();
+        if (bus.isActive && ++bus.bits <= 8) {
+            bus.value = bus.value << 1 | isSda;
+            if (bus.bits == 8) receiveByte(bus.value);
+        } else {
+            bus.bits = 0; // acknowledge clock
+        }
+    }
+    bus.isScl = isScl;
+    bus.isSda = isSda;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static void receiveByte(uint8_t b)
+{
+    /*  The slave drives SDA on the next clock, which the master reads on PINB.  */
+    busCount.bytes++;
+    if (bus.isAddress) {
+        bus.isAddress = false;
+        bus.isAddressed = (b == OLED_ADDRESS << 1); // write only
+        bus.isControl = true;
+        bus.argCount = 0;
+        if (!bus.isAddressed) busCount.naks++;
+    } else if (bus.isAddressed) {
+        if (bus.isControl) {
+            bus.isData = b & CONTROL_DATA;
+            bus.isSingle = b & CONTROL_CO;
+            bus.isControl = false;
+        } else {
+            (bus.isData) ? receiveData(b) : receiveCommand(b);
+            bus.isControl = bus.isSingle;
+        }
+    }
+    PINB = (bus.isAddressed) ? PINB & ~_BV(SDA_BIT) : PINB | _BV(SDA_BIT);
+}
+
+static void receiveCommand(uint8_t b)
+{
+    if (bus.argCount > 0) {
+        bus.args[bus.argIndex++] = b;
+        if (bus.argIndex == bus.argCount) {
+            executeCommand();
+            bus.argCount = 0;
+        }
+        return;
+    }
+    bus.command = b;
+    bus.argCount = getArgCount(b);
+    bus.argIndex = 0;
+    if (bus.argCount == 0) executeCommand();
+}
+
+static void executeCommand(void)
+{
+    uint8_t c = bus.command, *pArgs = bus.args;
+    if (c == 0xAE || c == 0xAF) {
+        oled.isOn = c & 1;
+    } else if (c == 0x81) {
+        oled.contrast = pArgs[0];
+    } else if (c == 0x8D) {
+        oled.isPumped = pArgs[0] & 0x04;
+    } else if (c == 0xA8) {
+        oled.mux = pArgs[0] & 0x3F;
+    } else if (c == 0x20) {
+        oled.mode = pArgs[0] & 0x03;
+    } else if (c == 0x21) {
+        oled.columnStart = oled.column = pArgs[0] & 0x7F;
+        oled.columnEnd = pArgs[1] & 0x7F;
+    } else if (c == 0x22) {
+        oled.pageStart = oled.page = pArgs[0] & 0x07;
+        oled.pageEnd = pArgs[1] & 0x07;
+    } else if (c >= 0xB0 && c <= 0xB7) {
+        oled.page = c & 0x07;
+    } else if (c <= 0x0F) {
+        oled.column = (oled.column & 0xF0) | c;
+    } else if (c <= 0x1F) {
+        oled.column = (oled.column & 0x0F) | (c & 0x07) << 4;
+    }
+}
+
+static void receiveData(uint8_t b)
+{
+    busCount.dataBytes++;
+    oled.gram[oled.page][oled.column] = b;
+    if (oled.mode == 0x02) { // page addressing stays in the page
+        oled.column = (oled.column == oled.columnEnd) ? oled.columnStart : oled.column + 1;
+        return;
+    }
+    bool isWrapped = false;
+    if (oled.mode == 0x00) { // horizontal
+        if (oled.column < oled.columnEnd) {
+            oled.column++;
+        } else {
+            oled.column = oled.columnStart;
+            isWrapped = (oled.page == oled.pageEnd);
+            oled.page = (isWrapped) ? oled.pageStart : oled.page + 1;
+        }
+    } else { // vertical
+        if (oled.page < oled.pageEnd) {
+            oled.page++;
+        } else {
+            oled.page = oled.pageStart;
+            isWrapped = (oled.column == oled.columnEnd);
+            oled.column = (isWrapped) ? oled.columnStart : oled.column + 1;
+        }
+    }
+    if (isWrapped) {
+        busCount.frames++;
+        if (onOledFrame) onOledFrame();
+    }
+}
+
+static uint8_t getArgCount(uint8_t command)
+{
+    if (command == 0x26 || command == 0x27) return 6;
+    if (command == 0x29 || command == 0x2A) return 5;
+    if (command == 0x20 || command == 0x81 || command == 0x8D || command == 0xA8 ||
+            command == 0xD3 || command == 0xD5 || command == 0xD9 || command == 0xDA ||
+            command == 0xDB) return 1;
+    if (command == 0x21 || command == 0x22 || command == 0xA3) return 2;
+    return 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+/*  Model of SSD1306 on the bit-banged I2C lines of ATtiny85, driven by the writes to DDRB.  */
+
+#include "../../common.h"
+
+/*  Defines  */
+
+#define OLED_ADDRESS    0x3C
+#define OLED_PAGES      8 // of GRAM, the panel shows HEIGHT / PAGE_HEIGHT of them
+
+/*  Typedefs  */
+
+typedef struct {
+    long    transactions, bytes, clocks, dataBytes, naks, frames;
+} BUS_COUNT_T;
+
+typedef struct {
+    bool    isOn, isPumped;
+    uint8_t contrast, mode, mux;
+    uint8_t columnStart, columnEnd, pageStart, pageEnd;
+    uint8_t column, page;
+    uint8_t gram[OLED_PAGES][WIDTH];
+} OLED_T;
+
+/*  Global Functions  */
+
+void    resetOled(void);
+uint16_t countLitPixels(void);
+
+/*  Global Variables  */
+
+extern OLED_T       oled;
+extern BUS_COUNT_T  busCount;
+extern void         (*onBusClock)(void);    // each rising edge of SCL
+extern void         (*onOledFrame)(void);   // the GRAM pointer wrapped to the start of the window
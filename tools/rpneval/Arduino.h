@@ -0,0 +1,22 @@
+#pragma once
+
+/*  Minimal stand-in for the Arduino core to build the calculator engine on a host.  */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROGMEM
+#define pgm_read_byte(p)    (*(const uint8_t *)(p))
+#define pgm_read_word(p)    (*(const uint16_t *)(p))
+#define pgm_read_ptr(p)     (*(void * const *)(p))
+#define memcpy_P            memcpy
+
+#undef  abs
+#define abs(x)              ((x) > 0 ? (x) : -(x))
+
+#ifdef __AVR_ATmega32U4__
+#define E2END               0x3FF
+#else
+#define E2END               0x1FF // ATtiny85
+#endif
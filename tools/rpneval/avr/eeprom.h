@@ -0,0 +1,16 @@
+#pragma once
+
+/*  EEPROM stand-in backed by RAM, the journal starts empty on every run.  */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define EEMEM
+
+static inline uint8_t eeprom_read_byte(const uint8_t *p) { return *p; }
+static inline void eeprom_update_byte(uint8_t *p, uint8_t value) { *p = value; }
+static inline uint16_t eeprom_read_word(const uint16_t *p) { return *p; }
+static inline void eeprom_update_word(uint16_t *p, uint16_t value) { *p = value; }
+static inline void eeprom_read_block(void *pDst, const void *pSrc, size_t n) { memcpy(pDst, pSrc, n); }
+static inline void eeprom_update_block(const void *pSrc, void *pDst, size_t n) { memcpy(pDst, pSrc, n); }
@@ -0,0 +1,95 @@
+/*
+  rpneval - Headless batch evaluator built on the calculator engine
+
+  Build on a host (from the top of the repository):
+
+    c++ -O2 -I tools/rpneval -o rpneval tools/rpneval/rpneval.cpp calc.cpp
+
+  Usage:
+
+    rpneval [file...]
+
+  Each input line is one keystroke sequence, evaluated from all clear.
+  A recorded program is kept across lines.
+  Tokens are separated by spaces.
+
+    0-9 .     Digit and dot keys, "12.5" presses 1, 2, ., 5
+    +/-       Invert sign
+    ENTER     Enter
+    + - * /   Operators
+    CLR       Clear
+    AC        All clear
+    SWAP      Exchange the top two numbers
+    ROLL      Roll the stack down
+    UNDO      Undo the last operation
+    LASTX     Recall the last operand
+    S+        Add the number to the statistics
+    MEAN SDEV SUM  Recall the mean, sample standard deviation and sum
+    REC       Start or stop recording a program
+    RUN       Run the recorded program
+
+  The top of the stack is printed for each line exactly as the screen
+  shows it, e.g. "1 ENTER 3 /" prints "0.3333333".
+*/
+
+#include <stdio.h>
+#include "tokens.h"
+
+/*  Defines  */
+
+#define LINE_MAX    1024
+
+/*  Local Functions  */
+
+static bool     evaluateLine(char *pLine);
+
+/*---------------------------------------------------------------------------*/
+
+void clearScreenBuffer(void)
+{
+    // Nothing is rendered
+}
+
+int main(int argc, char *argv[])
+{
+    static char line[LINE_MAX], text[TEXT_MAX];
+    bool isValid = true;
+    initCalc();
+    for (int i = 1; i < argc || i == 1; i++) {
+        FILE *fp = (argc > 1) ? fopen(argv[i], "r") : stdin;
+        if (fp == NULL) {
+            perror(argv[i]);
+            return 2;
+        }
+        while (fgets(line, sizeof(line), fp)) {
+            updateCalc(BTN_ALLCLEAR);
+            if (evaluateLine(line)) {
+                decodeCalc(0, text);
+                puts(text);
+            } else {
+                puts("?");
+                isValid = false;
+            }
+        }
+        if (fp != stdin) fclose(fp);
+    }
+    return isValid ? 0 : 1;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static bool evaluateLine(char *pLine)
+{
+    for (char *pToken = strtok(pLine, " \t\r\n"); pToken; pToken = strtok(NULL, " \t\r\n")) {
+        uint8_t button = getTokenButton(pToken);
+        if (button != BTN_NONE) {
+            updateCalc(button);
+            continue;
+        }
+        if (!isNumberToken(pToken)) return false;
+        for (char *p = pToken; *p; p++) {
+            updateCalc(getNumberButton(*p));
+        }
+    }
+    return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+/*  Key tokens of rpneval, shared by the host tools.  */
+
+#include <string.h>
+#include "../../common.h"
+
+static const struct {
+    const char  *pName;
+    uint8_t     button;
+} tokenTable[] = {
+    { "ENTER", BTN_ENTER    }, { "+/-", BTN_INVERT   }, { "+",   BTN_PLUS  },
+    { "-",     BTN_MINUS    }, { "*",   BTN_MULTI    }, { "/",   BTN_DIV   },
+    { "CLR",   BTN_CLEAR    }, { "AC",  BTN_ALLCLEAR }, { "REC", BTN_RECORD },
+    { "RUN",   BTN_RUN      }, { "SWAP", BTN_SWAP    }, { "ROLL", BTN_ROLL  },
+    { "UNDO",  BTN_UNDO     }, { "LASTX", BTN_LASTX  }, { "S+",  BTN_SIGMA },
+    { "MEAN",  BTN_MEAN     }, { "SDEV", BTN_SDEV    }, { "SUM",  BTN_SUM   },
+};
+
+static inline uint8_t getTokenButton(const char *pToken)
+{
+    for (uint8_t i = 0; i < sizeof(tokenTable) / sizeof(tokenTable[0]); i++) {
+        if (strcmp(pToken, tokenTable[i].pName) == 0) return tokenTable[i].button;
+    }
+    return BTN_NONE;
+}
+
+static inline bool isNumberToken(const char *pToken)
+{
+    /*  Digits and dots are pressed one by one, e.g. "12.5".  */
+    for (const char *p = pToken; *p; p++) {
+        if ((*p < '0' || *p > '9') && *p != '.') return false;
+    }
+    return *pToken != '\0';
+}
+
+static inline uint8_t getNumberButton(char c)
+{
+    return (c == '.') ? BTN_DOT : BTN_0 + c - '0';
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+/*  Stand-in for the Arduino core with Serial backed by a pseudo terminal.  */
+
+#include <stddef.h>
+#include "../rpneval/Arduino.h"
+
+class PtySerial {
+public:
+    void    begin(unsigned long baud) { (void)baud; }
+    int     available(void);
+    int     read(void);
+    size_t  write(uint8_t c);
+    size_t  print(const char *p);
+    int     fd;
+};
+
+extern PtySerial Serial;
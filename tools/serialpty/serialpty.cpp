@@ -0,0 +1,87 @@
+/*
+  serialpty - Host stand-in of the ATmega32U4 serial command channel
+
+  Build on a host (from the top of the repository):
+
+    c++ -O2 -D__AVR_ATmega32U4__ -I tools/serialpty -I tools/rpneval \
+        -o serialpty tools/serialpty/serialpty.cpp serial.cpp calc.cpp
+
+  Usage:
+
+    serialpty
+
+  It prints the path of a pseudo terminal and serves the protocol of
+  serial.cpp on it with the same calculation engine as ATmega32U4, e.g.
+
+    printf '1E3/\n' > /dev/pts/3 & head -1 /dev/pts/3
+*/
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include "../../common.h"
+
+/*  Global Variables  */
+
+PtySerial Serial;
+
+/*---------------------------------------------------------------------------*/
+
+void clearScreenBuffer(void)
+{
+    // Nothing is rendered
+}
+
+int main(void)
+{
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) {
+        perror("posix_openpt");
+        return 2;
+    }
+
+    /*  Pass the bytes as they are, like USB CDC.  */
+    int slave = open(ptsname(fd), O_RDWR | O_NOCTTY);
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    printf("%s\n", ptsname(fd));
+    fflush(stdout);
+    Serial.fd = fd;
+    initCalc();
+    initSerial();
+    while (true) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        poll(&pfd, 1, -1);
+        handleSerial();
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+
+int PtySerial::available(void)
+{
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    return poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN);
+}
+
+int PtySerial::read(void)
+{
+    uint8_t c;
+    return (available() && ::read(fd, &c, 1) == 1) ? c : -1;
+}
+
+size_t PtySerial::write(uint8_t c)
+{
+    return ::write(fd, &c, 1);
+}
+
+size_t PtySerial::print(const char *p)
+{
+    return ::write(fd, p, strlen(p));
+}
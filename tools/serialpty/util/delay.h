@@ -0,0 +1,5 @@
+#pragma once
+
+#include <unistd.h>
+
+#define _delay_us(us)   usleep(us)
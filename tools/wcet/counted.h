@@ -0,0 +1,102 @@
+#pragma once
+
+/*
+  Mantissa type of calc.cpp which counts the AVR cycles of its arithmetic.
+  It is included before calc.cpp with -include, which then takes MANT_T and
+  UMANT_T from HOST_MANT_T and HOST_UMANT_T.
+
+  The costs are those of avr-gcc at -Os. An add, subtract, negate or compare
+  takes one cycle per byte. A multiply or divide of 32 or 64 bits is a call
+  to libgcc: __mulsi3 runs a shift and add loop on ATtiny85 which has no MUL
+  instruction, and the divisions run one loop iteration per bit.
+*/
+
+#include <stdint.h>
+#include <type_traits>
+
+/*  Defines  */
+
+#ifdef __AVR_ATmega32U4__
+#define HOST_MANT_BASE_T    int64_t
+#define COST_ADD    8       // one cycle per byte
+#define COST_MUL    180     // __muldi3 with MUL
+#define COST_DIV    2600    // __divmoddi4, 64 iterations
+#else
+#define HOST_MANT_BASE_T    int32_t
+#define COST_ADD    4
+#define COST_MUL    300     // __mulsi3 without MUL
+#define COST_DIV    650     // __divmodsi4, 32 iterations
+#endif
+#define COST_CALL   8       // of the operands to the registers of the call
+
+#define HOST_MANT_T     CountedInt<HOST_MANT_BASE_T>
+#define HOST_UMANT_T    CountedInt<std::make_unsigned<HOST_MANT_BASE_T>::type>
+
+/*  Typedefs  */
+
+typedef struct {
+    long    cycles, adds, muls, divs;
+} OP_COUNT_T;
+
+/*  Global Variables  */
+
+extern OP_COUNT_T   opCount;
+
+/*---------------------------------------------------------------------------*/
+
+template <typename T>
+class CountedInt {
+public:
+    T   v;
+
+    CountedInt() = default;
+    template <typename U, typename = typename std::enable_if<std::is_integral<U>::value>::type>
+    CountedInt(U x) : v((T)x) {}
+    template <typename U>
+    CountedInt(CountedInt<U> x) : v((T)x.v) {}
+    operator T() const { return v; }
+
+    static T add(T x) { opCount.cycles += COST_ADD; opCount.adds++; return x; }
+    static T mul(T x) { opCount.cycles += COST_MUL + COST_CALL; opCount.muls++; return x; }
+    static T div(T x) { opCount.cycles += COST_DIV + COST_CALL; opCount.divs++; return x; }
+    static bool compare(bool x) { opCount.cycles += COST_ADD; opCount.adds++; return x; }
+
+    CountedInt operator-() const { return add(-v); }
+    CountedInt &operator+=(CountedInt x) { v = add(v + x.v); return *this; }
+    CountedInt &operator-=(CountedInt x) { v = add(v - x.v); return *this; }
+    CountedInt &operator*=(CountedInt x) { v = mul(v * x.v); return *this; }
+    CountedInt &operator/=(CountedInt x) { v = div(v / x.v); return *this; }
+    CountedInt &operator%=(CountedInt x) { v = div(v % x.v); return *this; }
+
+    friend CountedInt operator+(CountedInt x, CountedInt y) { return add(x.v + y.v); }
+    friend CountedInt operator-(CountedInt x, CountedInt y) { return add(x.v - y.v); }
+    friend CountedInt operator*(CountedInt x, CountedInt y) { return mul(x.v * y.v); }
+    friend CountedInt operator/(CountedInt x, CountedInt y) { return div(x.v / y.v); }
+    friend CountedInt operator%(CountedInt x, CountedInt y) { return div(x.v % y.v); }
+    friend bool operator==(CountedInt x, CountedInt y) { return compare(x.v == y.v); }
+    friend bool operator!=(CountedInt x, CountedInt y) { return compare(x.v != y.v); }
+    friend bool operator<(CountedInt x, CountedInt y) { return compare(x.v < y.v); }
+    friend bool operator>(CountedInt x, CountedInt y) { return compare(x.v > y.v); }
+    friend bool operator<=(CountedInt x, CountedInt y) { return compare(x.v <= y.v); }
+    friend bool operator>=(CountedInt x, CountedInt y) { return compare(x.v >= y.v); }
+};
+
+/*  The operators of plain integers convert them to the counted type.  */
+
+#define COUNTED_MIXED_OP(OP, RET) \
+    template <typename T, typename U, typename = typename std::enable_if<std::is_integral<U>::value>::type> \
+    RET operator OP(CountedInt<T> x, U y) { return x OP CountedInt<T>(y); } \
+    template <typename T, typename U, typename = typename std::enable_if<std::is_integral<U>::value>::type> \
+    RET operator OP(U x, CountedInt<T> y) { return CountedInt<T>(x) OP y; }
+
+COUNTED_MIXED_OP(+, CountedInt<T>)
+COUNTED_MIXED_OP(-, CountedInt<T>)
+COUNTED_MIXED_OP(*, CountedInt<T>)
+COUNTED_MIXED_OP(/, CountedInt<T>)
+COUNTED_MIXED_OP(%, CountedInt<T>)
+COUNTED_MIXED_OP(==, bool)
+COUNTED_MIXED_OP(!=, bool)
+COUNTED_MIXED_OP(<, bool)
+COUNTED_MIXED_OP(>, bool)
+COUNTED_MIXED_OP(<=, bool)
+COUNTED_MIXED_OP(>=, bool)
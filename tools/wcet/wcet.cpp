@@ -0,0 +1,487 @@
+/*
+  wcet - Worst case cycles of each key of calc.cpp
+
+  Build on a host (from the top of the repository), for the 32-bit mantissa
+  of ATtiny85 or with -D__AVR_ATmega32U4__ for the 64-bit one:
+
+    c++ -O2 -include tools/wcet/counted.h -I tools/wcet -I tools/rpneval \
+        -o wcet tools/wcet/wcet.cpp calc.cpp
+
+  Usage:
+
+    wcet [options] [limits]
+
+  The mantissa of calc.cpp is replaced by CountedInt of counted.h, which
+  adds up the AVR cycles of the additions, multiplications and divisions.
+  For each key, the stack, statistics or program before it are searched
+  for the slowest case: random operands from a set which is hard on the
+  arithmetic, e.g. long remainders, nines that carry and full 8 digits,
+  then mutations of the slowest one found. The search is seeded, so a run
+  is repeatable.
+
+  The worst cycles are compared with the limits file, limits32.txt or
+  limits64.txt of tools/wcet by the width. The exit status is 1 if any key
+  is slower than its limit.
+
+    -u        Write the limits file with the worst cycles of this run
+    -t n      Allowed slowdown in percent (0)
+    -n n      Random cases per key (20000)
+    -m n      Mutations of the slowest case per key (20000)
+    -s n      Seed (1)
+    -v        Print the slowest case of each key
+    -b n      Benchmark instead: the mean and the slowest of n cases per key
+              with uniform operands, to compare the widths of the mantissa
+*/
+
+#include <stdio.h>
+#include <unistd.h>
+#include "counted.h"
+#include "tokens.h"
+
+/*  Defines  */
+
+#define DISPLAY_MAX 8
+#define PROGRAM_MAX 24 // of calc.cpp
+#define TOKEN_MAX   80
+#define WORD_MAX    12
+#define LINE_MAX    1024
+#define PATH_MAX    1024
+
+/*  Typedefs  */
+
+enum : uint8_t {
+    TOKEN_FIXED = 0,
+    TOKEN_NUMBER,   // operand which the search may change
+    TOKEN_STEP,     // key of a recorded program which the search may change
+};
+
+typedef struct {
+    uint8_t count;
+    uint8_t kinds[TOKEN_MAX];
+    char    words[TOKEN_MAX][WORD_MAX];
+} SETUP_T;
+
+typedef struct {
+    const char  *pName;
+    uint8_t     button;
+    void        (*makeSetup)(SETUP_T *pSetup);
+} KEY_T;
+
+typedef struct {
+    OP_COUNT_T  count;
+    SETUP_T     setup;
+} CASE_T;
+
+/*  Local Functions  */
+
+static void     searchKey(const KEY_T *pKey, CASE_T *pWorst);
+static void     benchmarkKeys(long count);
+static OP_COUNT_T measureKey(uint8_t button, const SETUP_T *pSetup);
+static void     mutateSetup(SETUP_T *pSetup);
+static void     makeEntering(SETUP_T *pSetup);
+static void     makePair(SETUP_T *pSetup);
+static void     makeStack(SETUP_T *pSetup);
+static void     makeOperated(SETUP_T *pSetup);
+static void     makeEnter(SETUP_T *pSetup);
+static void     makeSummed(SETUP_T *pSetup);
+static void     makeSumming(SETUP_T *pSetup);
+static void     makeRecording(SETUP_T *pSetup);
+static void     makeProgram(SETUP_T *pSetup);
+static void     addToken(SETUP_T *pSetup, uint8_t kind, const char *pWord);
+static void     addNumber(SETUP_T *pSetup);
+static void     makeNumber(char *pText);
+static const char *makeStep(void);
+static void     printSetup(const SETUP_T *pSetup);
+static bool     readLimits(const char *pPath, long *pLimits);
+static bool     writeLimits(const char *pPath, const CASE_T *pWorst);
+static uint64_t getRandom(void);
+
+/*  Global Variables  */
+
+OP_COUNT_T      opCount;
+
+/*  Local Variables  */
+
+static const KEY_T keyTable[] = {
+    { "0-9",   BTN_9,        makeEntering  },
+    { ".",     BTN_DOT,      makeEntering  },
+    { "+/-",   BTN_INVERT,   makeEntering  },
+    { "ENTER", BTN_ENTER,    makeEnter     },
+    { "+",     BTN_PLUS,     makePair      },
+    { "-",     BTN_MINUS,    makePair      },
+    { "*",     BTN_MULTI,    makePair      },
+    { "/",     BTN_DIV,      makePair      },
+    { "CLR",   BTN_CLEAR,    makePair      },
+    { "AC",    BTN_ALLCLEAR, makeStack     },
+    { "SWAP",  BTN_SWAP,     makeStack     },
+    { "ROLL",  BTN_ROLL,     makeStack     },
+    { "UNDO",  BTN_UNDO,     makeOperated  },
+    { "LASTX", BTN_LASTX,    makeOperated  },
+    { "S+",    BTN_SIGMA,    makeSumming   },
+    { "MEAN",  BTN_MEAN,     makeSummed    },
+    { "SDEV",  BTN_SDEV,     makeSummed    },
+    { "SUM",   BTN_SUM,      makeSummed    },
+    { "REC",   BTN_RECORD,   makeRecording },
+    { "RUN",   BTN_RUN,      makeProgram   },
+};
+
+#define KEY_COUNT   (sizeof(keyTable) / sizeof(keyTable[0]))
+
+static const char *edgeTable[] = { // carry, cancel or leave long remainders
+    "99999999", "9999999.9", "0.9999999", "0.0000001", "1.0000001", "7", "0.0000007", "3",
+};
+
+#define EDGE_COUNT  (sizeof(edgeTable) / sizeof(edgeTable[0]))
+
+static long     caseCount = 20000, mutationCount = 20000;
+static uint64_t seed = 1;
+static bool     isUniform;
+
+/*---------------------------------------------------------------------------*/
+
+void clearScreenBuffer(void)
+{
+    // Nothing is rendered
+}
+
+#ifdef BATTERY_LEVELS
+uint8_t getBatteryLevel(void)
+{
+    return BATTERY_LEVELS;
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    static CASE_T worst[KEY_COUNT];
+    static long limits[KEY_COUNT];
+    static char path[PATH_MAX];
+    bool isUpdate = false, isVerbose = false;
+    long slowdown = 0, benchmarkCount = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "ut:n:m:s:vb:")) != -1) {
+        if (opt == 'u') isUpdate = true;
+        else if (opt == 't') slowdown = atol(optarg);
+        else if (opt == 'n') caseCount = atol(optarg);
+        else if (opt == 'm') mutationCount = atol(optarg);
+        else if (opt == 's') seed = strtoull(optarg, NULL, 0);
+        else if (opt == 'v') isVerbose = true;
+        else if (opt == 'b') benchmarkCount = atol(optarg);
+        else return 2;
+    }
+    if (benchmarkCount > 0) {
+        initCalc();
+        benchmarkKeys(benchmarkCount);
+        return 0;
+    }
+    snprintf(path, sizeof(path), "%s", (optind < argc) ? argv[optind] :
+            (sizeof(HOST_MANT_BASE_T) == 8) ? "tools/wcet/limits64.txt" : "tools/wcet/limits32.txt");
+    bool isLimited = !isUpdate && readLimits(path, limits);
+    if (!isUpdate && !isLimited) fprintf(stderr, "%s: no limits\n", path);
+
+    initCalc();
+    int slower = 0;
+    printf("%d-bit mantissa, modeled cycles of the arithmetic\n", (int)sizeof(HOST_MANT_BASE_T) * 8);
+    printf("%-6s %9s %6s %6s %9s\n", "key", "worst", "mul", "div", "limit");
+    for (uint8_t i = 0; i < KEY_COUNT; i++) {
+        searchKey(&keyTable[i], &worst[i]);
+        const OP_COUNT_T *pCount = &worst[i].count;
+        printf("%-6s %9ld %6ld %6ld", keyTable[i].pName, pCount->cycles, pCount->muls, pCount->divs);
+        if (isLimited && limits[i] >= 0) {
+            bool isSlower = (pCount->cycles * 100 > limits[i] * (100 + slowdown));
+            printf(" %9ld%s", limits[i], (isSlower) ? "  slower" : "");
+            if (isSlower) slower++;
+        }
+        putchar('\n');
+        if (isVerbose) {
+            printf("       ");
+            printSetup(&worst[i].setup);
+            printf(" %s\n", keyTable[i].pName);
+        }
+    }
+    if (isUpdate) {
+        if (!writeLimits(path, worst)) return 2;
+        printf("%s written\n", path);
+    } else if (isLimited) {
+        printf("%d keys slower than the limits\n", slower);
+    }
+    return (slower == 0) ? 0 : 1;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static void searchKey(const KEY_T *pKey, CASE_T *pWorst)
+{
+    /*  Each key has its own sequence, so adding a key keeps the others.  */
+    static CASE_T trial;
+    uint64_t keySeed = seed * 0x9E3779B97F4A7C15ULL + pKey->button;
+    uint64_t savedSeed = seed;
+    seed = (keySeed == 0) ? 1 : keySeed;
+    memset(pWorst, 0, sizeof(*pWorst));
+    for (long i = 0; i < caseCount + mutationCount; i++) {
+        if (i < caseCount) {
+            memset(&trial.setup, 0, sizeof(trial.setup));
+            pKey->makeSetup(&trial.setup);
+        } else {
+            trial.setup = pWorst->setup;
+            mutateSetup(&trial.setup);
+        }
+        trial.count = measureKey(pKey->button, &trial.setup);
+        if (trial.count.cycles > pWorst->count.cycles ||
+                (i >= caseCount && trial.count.cycles == pWorst->count.cycles)) *pWorst = trial; // walk on plateaus
+    }
+    seed = savedSeed;
+}
+
+static void benchmarkKeys(long count)
+{
+    static SETUP_T setup;
+    isUniform = true;
+    printf("%d-bit mantissa, %d bytes per number on AVR, modeled cycles of the arithmetic\n",
+            (int)sizeof(HOST_MANT_BASE_T) * 8, (int)sizeof(HOST_MANT_BASE_T) + 1);
+    printf("%-6s %9s %9s %8s %8s\n", "key", "mean", "slowest", "mul", "div");
+    for (uint8_t i = 0; i < KEY_COUNT; i++) {
+        OP_COUNT_T total = { 0, 0, 0, 0 };
+        long slowest = 0;
+        for (long j = 0; j < count; j++) {
+            memset(&setup, 0, sizeof(setup));
+            keyTable[i].makeSetup(&setup);
+            OP_COUNT_T c = measureKey(keyTable[i].button, &setup);
+            total.cycles += c.cycles;
+            total.muls += c.muls;
+            total.divs += c.divs;
+            if (c.cycles > slowest) slowest = c.cycles;
+        }
+        printf("%-6s %9.0f %9ld %8.1f %8.1f\n", keyTable[i].pName, (double)total.cycles / count, slowest,
+                (double)total.muls / count, (double)total.divs / count);
+    }
+}
+
+static OP_COUNT_T measureKey(uint8_t button, const SETUP_T *pSetup)
+{
+    updateCalc(BTN_ALLCLEAR);
+    for (uint8_t i = 0; i < pSetup->count; i++) {
+        const char *pWord = pSetup->words[i];
+        uint8_t tokenButton = getTokenButton(pWord);
+        if (tokenButton != BTN_NONE) {
+            updateCalc(tokenButton);
+        } else {
+            for (const char *p = pWord; *p; p++) updateCalc(getNumberButton(*p));
+        }
+    }
+    memset(&opCount, 0, sizeof(opCount));
+    updateCalc(button);
+    OP_COUNT_T count = opCount;
+    if (button == BTN_RECORD) updateCalc(BTN_RECORD); // stop recording for the next case
+    return count;
+}
+
+static void mutateSetup(SETUP_T *pSetup)
+{
+    /*  Up to 3 tokens at once, the slowest statistics need a few of them.  */
+    uint8_t changes = 1 + getRandom() % 3;
+    for (uint8_t tries = 0; tries < TOKEN_MAX && changes > 0 && pSetup->count > 0; tries++) {
+        uint8_t i = getRandom() % pSetup->count;
+        uint64_t r = getRandom();
+        if (pSetup->kinds[i] == TOKEN_NUMBER) {
+            if (r & 1) {
+                strcpy(pSetup->words[i], edgeTable[(r >> 1) % EDGE_COUNT]);
+            } else {
+                makeNumber(pSetup->words[i]);
+            }
+            changes--;
+        } else if (pSetup->kinds[i] == TOKEN_STEP) {
+            strcpy(pSetup->words[i], makeStep());
+            changes--;
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+
+static void makeEntering(SETUP_T *pSetup)
+{
+    /*  A number being typed, the key goes on it.  */
+    if (getRandom() & 1) {
+        addNumber(pSetup);
+        addToken(pSetup, TOKEN_FIXED, "ENTER");
+    }
+    addNumber(pSetup);
+}
+
+static void makePair(SETUP_T *pSetup)
+{
+    addNumber(pSetup);
+    addToken(pSetup, TOKEN_FIXED, "ENTER");
+    addNumber(pSetup);
+    if (getRandom() & 1) addToken(pSetup, TOKEN_FIXED, "ENTER");
+    if (getRandom() & 1) addToken(pSetup, TOKEN_FIXED, "SWAP");
+}
+
+static void makeStack(SETUP_T *pSetup)
+{
+    uint8_t count = 1 + getRandom() % 16;
+    for (uint8_t i = 0; i < count; i++) {
+        if (i > 0) addToken(pSetup, TOKEN_FIXED, "ENTER");
+        addNumber(pSetup);
+    }
+}
+
+static void makeOperated(SETUP_T *pSetup)
+{
+    static const char *opWords[] = { "+", "-", "*", "/" };
+    addNumber(pSetup);
+    addToken(pSetup, TOKEN_FIXED, "ENTER");
+    addNumber(pSetup);
+    addToken(pSetup, TOKEN_FIXED, opWords[getRandom() % 4]);
+}
+
+static void makeEnter(SETUP_T *pSetup)
+{
+    /*  Finishing a number typed or copying a result.  */
+    if (getRandom() & 1) {
+        makeEntering(pSetup);
+    } else {
+        makeOperated(pSetup);
+    }
+}
+
+static void makeSummed(SETUP_T *pSetup)
+{
+    uint8_t count = 1 + getRandom() % 6;
+    for (uint8_t i = 0; i < count; i++) {
+        addNumber(pSetup);
+        addToken(pSetup, TOKEN_FIXED, "S+");
+    }
+}
+
+static void makeSumming(SETUP_T *pSetup)
+{
+    uint8_t count = getRandom() % 6;
+    for (uint8_t i = 0; i < count; i++) {
+        addNumber(pSetup);
+        addToken(pSetup, TOKEN_FIXED, "S+");
+    }
+    addNumber(pSetup);
+}
+
+static void makeRecording(SETUP_T *pSetup)
+{
+    addToken(pSetup, TOKEN_FIXED, "REC");
+    makeOperated(pSetup);
+}
+
+static void makeProgram(SETUP_T *pSetup)
+{
+    /*  A full program of slow keys on statistics and a stack of operands.  */
+    addToken(pSetup, TOKEN_FIXED, "REC");
+    const char *pStep = (getRandom() & 1) ? makeStep() : NULL; // the same step over, or any
+    for (uint8_t i = 0; i < PROGRAM_MAX; i++) addToken(pSetup, TOKEN_STEP, (pStep) ? pStep : makeStep());
+    addToken(pSetup, TOKEN_FIXED, "REC");
+    addToken(pSetup, TOKEN_FIXED, "AC");
+    makeSummed(pSetup);
+    makeStack(pSetup);
+}
+
+static void addToken(SETUP_T *pSetup, uint8_t kind, const char *pWord)
+{
+    if (pSetup->count < TOKEN_MAX) {
+        pSetup->kinds[pSetup->count] = kind;
+        strcpy(pSetup->words[pSetup->count++], pWord);
+    }
+}
+
+static void addNumber(SETUP_T *pSetup)
+{
+    static char text[WORD_MAX];
+    makeNumber(text);
+    addToken(pSetup, TOKEN_NUMBER, text);
+}
+
+static void makeNumber(char *pText)
+{
+    /*  Up to 8 digits with up to 7 decimals as typed, nines and sevens
+        carry and leave long remainders unless uniform.  */
+    static const char hardDigits[] = "9979";
+    uint64_t r = getRandom();
+    if ((r & 7) == 0 && !isUniform) {
+        strcpy(pText, edgeTable[(r >> 3) % EDGE_COUNT]);
+        return;
+    }
+    bool isHard = (r >> 3 & 3) == 0 && !isUniform;
+    uint8_t intLen = (r >> 5) % (DISPLAY_MAX + 1);
+    uint8_t fracMax = (intLen == 0) ? DISPLAY_MAX - 1 : DISPLAY_MAX - intLen;
+    uint8_t fracLen = (r >> 9 & 1) ? fracMax : (r >> 10) % (fracMax + 1); // full length half the time
+    if (intLen == 0 && fracLen == 0) fracLen = 1;
+    char *p = pText;
+    if (intLen == 0) *p++ = '0';
+    for (uint8_t i = 0; i < intLen + fracLen; i++) {
+        if (i == intLen) *p++ = '.';
+        uint64_t d = getRandom();
+        char c = (isHard) ? hardDigits[d & 3] : '0' + d % 10;
+        if (i == 0 && intLen > 0 && c == '0') c = '1';
+        *p++ = c;
+    }
+    *p = '\0';
+}
+
+static const char *makeStep(void)
+{
+    static const char *stepTable[] = {
+        "*", "/", "+", "-", "SDEV", "MEAN", "S+", "ENTER", "LASTX", "SWAP", "7", "9",
+    };
+    return stepTable[getRandom() % (sizeof(stepTable) / sizeof(stepTable[0]))];
+}
+
+static void printSetup(const SETUP_T *pSetup)
+{
+    if (pSetup->count == 0) printf("(any)");
+    for (uint8_t i = 0; i < pSetup->count; i++) {
+        printf("%s%s", (i > 0) ? " " : "", pSetup->words[i]);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+
+static bool readLimits(const char *pPath, long *pLimits)
+{
+    /*  Lines of a key name and its cycles, # starts a comment.  */
+    static char line[LINE_MAX], name[LINE_MAX];
+    FILE *fp = fopen(pPath, "r");
+    if (fp == NULL) return false;
+    for (uint8_t i = 0; i < KEY_COUNT; i++) pLimits[i] = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        long cycles;
+        if (line[0] == '#' || sscanf(line, "%s %ld", name, &cycles) != 2) continue;
+        for (uint8_t i = 0; i < KEY_COUNT; i++) {
+            if (strcmp(name, keyTable[i].pName) == 0) pLimits[i] = cycles;
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+static bool writeLimits(const char *pPath, const CASE_T *pWorst)
+{
+    FILE *fp = fopen(pPath, "w");
+    if (fp == NULL) {
+        perror(pPath);
+        return false;
+    }
+    fprintf(fp, "# Worst modeled cycles of each key with the %d-bit mantissa, written by wcet -u\n",
+            (int)sizeof(HOST_MANT_BASE_T) * 8);
+    for (uint8_t i = 0; i < KEY_COUNT; i++) {
+        fprintf(fp, "%-6s %ld\n", keyTable[i].pName, pWorst[i].count.cycles);
+    }
+    fclose(fp);
+    return true;
+}
+
+static uint64_t getRandom(void)
+{
+    /*  xorshift64*, the same seed gives the same run.  */
+    seed ^= seed >> 12;
+    seed ^= seed << 25;
+    seed ^= seed >> 27;
+    return seed * 0x2545F4914F6CDD1DULL;
+}